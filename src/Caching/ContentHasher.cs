@@ -0,0 +1,315 @@
+﻿////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-mozjpeg, a FileType plugin for Paint.NET
+// that saves JPEG images using the mozjpeg encoder.
+//
+// Copyright (c) 2021, 2022 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+using System;
+using System.Buffers.Binary;
+using System.Numerics;
+using System.Runtime.InteropServices;
+using System.Runtime.Intrinsics;
+using System.Runtime.Intrinsics.X86;
+
+namespace MozJpegFileType.Caching
+{
+    /// <summary>
+    /// A streaming 128-bit non-cryptographic hash that processes 32-byte stripes with 4 independent lanes.
+    /// </summary>
+    /// <remarks>
+    /// The lane accumulation follows the XXH3 design: each stripe in a block is keyed with a different
+    /// offset into the secret, and the data of each lane is also added to its neighboring lane.
+    /// This makes the hash depend on the order of the stripes, which a per-lane sum would not.
+    /// The AVX2 path and the scalar path produce the same result.
+    /// This must be kept in sync with the ContentHasher class in ContentHasher.cpp.
+    /// </remarks>
+    internal sealed class ContentHasher
+    {
+        private const int LaneCount = 4;
+        private const int StripeLength = LaneCount * sizeof(ulong);
+        private const int StripesPerBlock = 32;
+        // Stripe N of a block uses the secret values starting at N, the values after
+        // those are used to scramble the accumulators at the end of each block.
+        private const int ScrambleSecretOffset = StripesPerBlock + LaneCount;
+
+        private const ulong Prime32_1 = 0x9E3779B1UL;
+        private const ulong Prime64_1 = 0x9E3779B185EBCA87UL;
+        private const ulong Prime64_2 = 0xC2B2AE3D27D4EB4FUL;
+
+        private static readonly ulong[] Secret = CreateSecret(ScrambleSecretOffset + LaneCount);
+
+        private readonly byte[] pendingStripe;
+        private int pendingLength;
+        private ulong acc0;
+        private ulong acc1;
+        private ulong acc2;
+        private ulong acc3;
+        private int stripesInBlock;
+        private ulong totalLength;
+
+        public ContentHasher()
+        {
+            this.pendingStripe = new byte[StripeLength];
+            this.pendingLength = 0;
+            this.acc0 = Prime32_1;
+            this.acc1 = Prime64_1;
+            this.acc2 = Prime64_2;
+            this.acc3 = Prime32_1 ^ Prime64_2;
+            this.stripesInBlock = 0;
+            this.totalLength = 0;
+        }
+
+        public void Append(ReadOnlySpan<byte> data)
+        {
+            this.totalLength += (ulong)data.Length;
+
+            if (this.pendingLength > 0)
+            {
+                int bytesToCopy = Math.Min(StripeLength - this.pendingLength, data.Length);
+
+                data.Slice(0, bytesToCopy).CopyTo(this.pendingStripe.AsSpan(this.pendingLength));
+                this.pendingLength += bytesToCopy;
+                data = data.Slice(bytesToCopy);
+
+                if (this.pendingLength < StripeLength)
+                {
+                    return;
+                }
+
+                ProcessStripes(this.pendingStripe);
+                this.pendingLength = 0;
+            }
+
+            int wholeStripeLength = data.Length - (data.Length % StripeLength);
+
+            if (wholeStripeLength > 0)
+            {
+                ProcessStripes(data.Slice(0, wholeStripeLength));
+                data = data.Slice(wholeStripeLength);
+            }
+
+            if (data.Length > 0)
+            {
+                data.CopyTo(this.pendingStripe);
+                this.pendingLength = data.Length;
+            }
+        }
+
+        public void Append(int value)
+        {
+            Span<byte> bytes = stackalloc byte[sizeof(int)];
+            BinaryPrimitives.WriteInt32LittleEndian(bytes, value);
+
+            Append(bytes);
+        }
+
+        public void Append(float value)
+        {
+            Append(BitConverter.SingleToInt32Bits(value));
+        }
+
+        /// <summary>
+        /// Appends the length of the data followed by the data, a null array is distinct from an empty array.
+        /// </summary>
+        public void AppendWithLength(byte[] data)
+        {
+            if (data is null)
+            {
+                Append(-1);
+            }
+            else
+            {
+                Append(data.Length);
+                Append(data);
+            }
+        }
+
+        public EncodeCacheKey GetHash()
+        {
+            ulong a0 = this.acc0;
+            ulong a1 = this.acc1;
+            ulong a2 = this.acc2;
+            ulong a3 = this.acc3;
+
+            // Mix the tail bytes that do not fill a complete stripe.
+            for (int i = 0; i < this.pendingLength; i++)
+            {
+                ulong value = (ulong)this.pendingStripe[i] * Prime64_1;
+
+                switch (i & 3)
+                {
+                    case 0:
+                        a0 = BitOperations.RotateLeft(a0 ^ value, 23) * Prime64_2;
+                        break;
+                    case 1:
+                        a1 = BitOperations.RotateLeft(a1 ^ value, 23) * Prime64_2;
+                        break;
+                    case 2:
+                        a2 = BitOperations.RotateLeft(a2 ^ value, 23) * Prime64_2;
+                        break;
+                    default:
+                        a3 = BitOperations.RotateLeft(a3 ^ value, 23) * Prime64_2;
+                        break;
+                }
+            }
+
+            // Both halves fold all of the lanes together, each with different secret values.
+            ulong low = Avalanche(MultiplyFold(a0 ^ Secret[0], a1 ^ Secret[1])
+                                  + MultiplyFold(a2 ^ Secret[2], a3 ^ Secret[3])
+                                  + (this.totalLength * Prime64_1));
+            ulong high = Avalanche(MultiplyFold(a0 ^ Secret[4], a1 ^ Secret[5])
+                                   + MultiplyFold(a2 ^ Secret[6], a3 ^ Secret[7])
+                                   + ~(this.totalLength * Prime64_2));
+
+            return new EncodeCacheKey(low, high);
+        }
+
+        private static ulong[] CreateSecret(int length)
+        {
+            // The secret values are generated with SplitMix64 from a fixed seed,
+            // the output must not change between runs because the keys are stored on disk.
+            ulong[] secret = new ulong[length];
+            ulong state = 0x243F6A8885A308D3UL;
+
+            for (int i = 0; i < secret.Length; i++)
+            {
+                state += 0x9E3779B97F4A7C15UL;
+
+                ulong value = state;
+                value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9UL;
+                value = (value ^ (value >> 27)) * 0x94D049BB133111EBUL;
+
+                secret[i] = value ^ (value >> 31);
+            }
+
+            return secret;
+        }
+
+        private static ulong Avalanche(ulong value)
+        {
+            value ^= value >> 37;
+            value *= 0x165667919E3779F9UL;
+            value ^= value >> 32;
+
+            return value;
+        }
+
+        private static ulong MultiplyFold(ulong left, ulong right)
+        {
+            ulong high = Math.BigMul(left, right, out ulong low);
+
+            return low ^ high;
+        }
+
+        private void ProcessStripes(ReadOnlySpan<byte> stripes)
+        {
+            if (Avx2.IsSupported)
+            {
+                ProcessStripesAvx2(stripes);
+            }
+            else
+            {
+                ProcessStripesScalar(stripes);
+            }
+        }
+
+        private unsafe void ProcessStripesAvx2(ReadOnlySpan<byte> stripes)
+        {
+            Vector256<ulong> acc = Vector256.Create(this.acc0, this.acc1, this.acc2, this.acc3);
+            Vector256<uint> prime = Vector256.Create((uint)Prime32_1);
+
+            fixed (byte* ptr = stripes)
+            fixed (ulong* secretPtr = Secret)
+            {
+                Vector256<ulong> scrambleSecret = Avx.LoadVector256(secretPtr + ScrambleSecretOffset);
+
+                byte* current = ptr;
+                byte* end = ptr + stripes.Length;
+
+                while (current < end)
+                {
+                    Vector256<ulong> data = Avx.LoadVector256((ulong*)current);
+                    Vector256<ulong> key = Avx2.Xor(data, Avx.LoadVector256(secretPtr + this.stripesInBlock));
+                    Vector256<ulong> keyHigh = Avx2.ShiftRightLogical(key, 32);
+                    // Swap the 64-bit lanes in each pair, as in lanes[i ^ 1].
+                    Vector256<ulong> swappedData = Avx2.Shuffle(data.AsUInt32(), 0x4E).AsUInt64();
+
+                    acc = Avx2.Add(acc, Avx2.Add(swappedData, Avx2.Multiply(key.AsUInt32(), keyHigh.AsUInt32())));
+
+                    this.stripesInBlock++;
+
+                    if (this.stripesInBlock == StripesPerBlock)
+                    {
+                        acc = Avx2.Xor(acc, Avx2.ShiftRightLogical(acc, 47));
+                        acc = Avx2.Xor(acc, scrambleSecret);
+
+                        Vector256<ulong> productLow = Avx2.Multiply(acc.AsUInt32(), prime);
+                        Vector256<ulong> productHigh = Avx2.Multiply(Avx2.ShiftRightLogical(acc, 32).AsUInt32(), prime);
+
+                        acc = Avx2.Add(productLow, Avx2.ShiftLeftLogical(productHigh, 32));
+
+                        this.stripesInBlock = 0;
+                    }
+
+                    current += StripeLength;
+                }
+            }
+
+            this.acc0 = acc.GetElement(0);
+            this.acc1 = acc.GetElement(1);
+            this.acc2 = acc.GetElement(2);
+            this.acc3 = acc.GetElement(3);
+        }
+
+        private void ProcessStripesScalar(ReadOnlySpan<byte> stripes)
+        {
+            ReadOnlySpan<ulong> lanes = MemoryMarshal.Cast<byte, ulong>(stripes);
+
+            for (int i = 0; i < lanes.Length; i += LaneCount)
+            {
+                int secretOffset = this.stripesInBlock;
+
+                ulong data0 = lanes[i];
+                ulong data1 = lanes[i + 1];
+                ulong data2 = lanes[i + 2];
+                ulong data3 = lanes[i + 3];
+
+                this.acc0 += data1 + MultiplyHalves(data0 ^ Secret[secretOffset]);
+                this.acc1 += data0 + MultiplyHalves(data1 ^ Secret[secretOffset + 1]);
+                this.acc2 += data3 + MultiplyHalves(data2 ^ Secret[secretOffset + 2]);
+                this.acc3 += data2 + MultiplyHalves(data3 ^ Secret[secretOffset + 3]);
+
+                this.stripesInBlock++;
+
+                if (this.stripesInBlock == StripesPerBlock)
+                {
+                    this.acc0 = Scramble(this.acc0, Secret[ScrambleSecretOffset]);
+                    this.acc1 = Scramble(this.acc1, Secret[ScrambleSecretOffset + 1]);
+                    this.acc2 = Scramble(this.acc2, Secret[ScrambleSecretOffset + 2]);
+                    this.acc3 = Scramble(this.acc3, Secret[ScrambleSecretOffset + 3]);
+
+                    this.stripesInBlock = 0;
+                }
+            }
+
+            static ulong MultiplyHalves(ulong key)
+            {
+                return (key & 0xFFFFFFFF) * (key >> 32);
+            }
+
+            static ulong Scramble(ulong acc, ulong secret)
+            {
+                acc ^= acc >> 47;
+                acc ^= secret;
+
+                return acc * Prime32_1;
+            }
+        }
+    }
+}
@@ -0,0 +1,331 @@
+﻿////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-mozjpeg, a FileType plugin for Paint.NET
+// that saves JPEG images using the mozjpeg encoder.
+//
+// Copyright (c) 2021, 2022 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+using MozJpegFileType.Interop;
+using PaintDotNet;
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Linq;
+using System.Security.Cryptography;
+using System.Text;
+
+namespace MozJpegFileType.Caching
+{
+    /// <summary>
+    /// A content-addressed cache of encoded JPEG images, with a bounded in-memory LRU and an optional on-disk LRU.
+    /// </summary>
+    /// <remarks>
+    /// The disk cache is disabled unless the PDN_MOZJPEG_DISK_ENCODE_CACHE environment variable is set to 1.
+    /// It is stored in the user's local application data folder, and the file names are keyed with a random
+    /// per-user secret so that the name of the file for an image cannot be predicted.
+    /// The disk cache is best-effort, any I/O errors are treated as a cache miss.
+    /// </remarks>
+    internal sealed class EncodeCache
+    {
+        /// <summary>
+        /// The maximum size of an encoded image that will be added to the cache.
+        /// </summary>
+        public const int MaxEntrySize = 32 * 1024 * 1024;
+
+        private const long MaxMemoryCacheSize = 64L * 1024 * 1024;
+        private const long MaxDiskCacheSize = 512L * 1024 * 1024;
+        private const string DiskCacheEnvironmentVariable = "PDN_MOZJPEG_DISK_ENCODE_CACHE";
+        private const string CacheFileExtension = ".jpg";
+        private const string SecretFileName = "CacheSecret.bin";
+        private const int SecretLength = 32;
+
+        private readonly object sync;
+        private readonly Dictionary<EncodeCacheKey, LinkedListNode<KeyValuePair<EncodeCacheKey, ArraySegment<byte>>>> memoryEntries;
+        private readonly LinkedList<KeyValuePair<EncodeCacheKey, ArraySegment<byte>>> memoryLru;
+        private readonly string diskCacheDirectory;
+        private readonly Lazy<byte[]> diskCacheSecret;
+        private long memoryCacheSize;
+
+        private EncodeCache()
+        {
+            this.sync = new object();
+            this.memoryEntries = new Dictionary<EncodeCacheKey, LinkedListNode<KeyValuePair<EncodeCacheKey, ArraySegment<byte>>>>();
+            this.memoryLru = new LinkedList<KeyValuePair<EncodeCacheKey, ArraySegment<byte>>>();
+            this.diskCacheDirectory = GetDiskCacheDirectory();
+            this.diskCacheSecret = new Lazy<byte[]>(LoadOrCreateDiskCacheSecret);
+            this.memoryCacheSize = 0;
+        }
+
+        public static EncodeCache Instance { get; } = new EncodeCache();
+
+        public static unsafe EncodeCacheKey CreateKey(Surface surface, in EncodeOptions options, bool incremental, MetadataParams metadata)
+        {
+            ContentHasher hasher = new ContentHasher();
+
+            // The plugin version is included so that an update to the encoder invalidates the cache.
+            hasher.AppendWithLength(Encoding.UTF8.GetBytes(typeof(EncodeCache).Assembly.GetName().Version.ToString()));
+            hasher.Append(surface.Width);
+            hasher.Append(surface.Height);
+
+            int rowLengthInBytes = surface.Width * ColorBgra.SizeOf;
+
+            for (int y = 0; y < surface.Height; y++)
+            {
+                hasher.Append(new ReadOnlySpan<byte>(surface.GetRowPointerUnchecked(y), rowLengthInBytes));
+            }
+
+            hasher.Append(options.quality);
+            hasher.Append((int)options.chromaSubsampling);
+            hasher.Append(options.progressive ? 1 : 0);
+            hasher.Append(options.autoSelect ? 1 : 0);
+            hasher.Append(options.autoMinimumPsnr);
+            hasher.Append(options.singlePass ? 1 : 0);
+            hasher.Append(incremental ? 1 : 0);
+
+            hasher.AppendWithLength(metadata.exif);
+            hasher.AppendWithLength(metadata.iccProfile);
+            hasher.AppendWithLength(metadata.standardXmp);
+            hasher.Append(metadata.extendedXmpChunks.Count);
+
+            foreach (byte[] chunk in metadata.extendedXmpChunks)
+            {
+                hasher.AppendWithLength(chunk);
+            }
+
+            return hasher.GetHash();
+        }
+
+        public void Add(EncodeCacheKey key, ArraySegment<byte> encodedImage)
+        {
+            AddToMemoryCache(key, encodedImage);
+
+            string path = TryGetCacheFilePath(key);
+
+            if (path is null)
+            {
+                return;
+            }
+
+            try
+            {
+                string tempPath = path + ".tmp";
+
+                using (FileStream stream = new FileStream(tempPath, FileMode.Create, FileAccess.Write, FileShare.None))
+                {
+                    stream.Write(encodedImage);
+                }
+
+                File.Move(tempPath, path, overwrite: true);
+
+                TrimDiskCache();
+            }
+            catch (IOException)
+            {
+            }
+            catch (UnauthorizedAccessException)
+            {
+            }
+        }
+
+        public bool TryWriteTo(EncodeCacheKey key, Stream output)
+        {
+            ArraySegment<byte> encodedImage = default;
+            bool found = false;
+
+            lock (this.sync)
+            {
+                if (this.memoryEntries.TryGetValue(key, out LinkedListNode<KeyValuePair<EncodeCacheKey, ArraySegment<byte>>> node))
+                {
+                    this.memoryLru.Remove(node);
+                    this.memoryLru.AddFirst(node);
+
+                    encodedImage = node.Value.Value;
+                    found = true;
+                }
+            }
+
+            if (!found)
+            {
+                byte[] diskCacheData = TryReadFromDiskCache(key);
+
+                if (diskCacheData is null)
+                {
+                    return false;
+                }
+
+                encodedImage = new ArraySegment<byte>(diskCacheData);
+                AddToMemoryCache(key, encodedImage);
+            }
+
+            output.Write(encodedImage);
+
+            return true;
+        }
+
+        private static string GetDiskCacheDirectory()
+        {
+            if (Environment.GetEnvironmentVariable(DiskCacheEnvironmentVariable) != "1")
+            {
+                return null;
+            }
+
+            string localAppData = Environment.GetFolderPath(Environment.SpecialFolder.LocalApplicationData);
+
+            if (string.IsNullOrEmpty(localAppData))
+            {
+                return null;
+            }
+
+            return Path.Combine(localAppData, "pdn-mozjpeg", "EncodeCache");
+        }
+
+        private byte[] LoadOrCreateDiskCacheSecret()
+        {
+            try
+            {
+                Directory.CreateDirectory(this.diskCacheDirectory);
+
+                string path = Path.Combine(this.diskCacheDirectory, SecretFileName);
+
+                try
+                {
+                    byte[] secret = RandomNumberGenerator.GetBytes(SecretLength);
+
+                    using (FileStream stream = new FileStream(path, FileMode.CreateNew, FileAccess.Write, FileShare.None))
+                    {
+                        stream.Write(secret, 0, secret.Length);
+                    }
+
+                    return secret;
+                }
+                catch (IOException) when (File.Exists(path))
+                {
+                    byte[] secret = File.ReadAllBytes(path);
+
+                    return secret.Length == SecretLength ? secret : null;
+                }
+            }
+            catch (IOException)
+            {
+                return null;
+            }
+            catch (UnauthorizedAccessException)
+            {
+                return null;
+            }
+        }
+
+        private void AddToMemoryCache(EncodeCacheKey key, ArraySegment<byte> encodedImage)
+        {
+            if (encodedImage.Count > MaxEntrySize)
+            {
+                return;
+            }
+
+            lock (this.sync)
+            {
+                if (this.memoryEntries.ContainsKey(key))
+                {
+                    return;
+                }
+
+                LinkedListNode<KeyValuePair<EncodeCacheKey, ArraySegment<byte>>> node = this.memoryLru.AddFirst(
+                    new KeyValuePair<EncodeCacheKey, ArraySegment<byte>>(key, encodedImage));
+
+                this.memoryEntries.Add(key, node);
+                this.memoryCacheSize += encodedImage.Count;
+
+                while (this.memoryCacheSize > MaxMemoryCacheSize)
+                {
+                    LinkedListNode<KeyValuePair<EncodeCacheKey, ArraySegment<byte>>> last = this.memoryLru.Last;
+
+                    this.memoryLru.RemoveLast();
+                    this.memoryEntries.Remove(last.Value.Key);
+                    this.memoryCacheSize -= last.Value.Value.Count;
+                }
+            }
+        }
+
+        private string TryGetCacheFilePath(EncodeCacheKey key)
+        {
+            if (this.diskCacheDirectory is null)
+            {
+                return null;
+            }
+
+            byte[] secret = this.diskCacheSecret.Value;
+
+            if (secret is null)
+            {
+                return null;
+            }
+
+            byte[] fileNameHash = HMACSHA256.HashData(secret, Encoding.ASCII.GetBytes(key.ToString()));
+
+            return Path.Combine(this.diskCacheDirectory, Convert.ToHexString(fileNameHash).ToLowerInvariant() + CacheFileExtension);
+        }
+
+        private byte[] TryReadFromDiskCache(EncodeCacheKey key)
+        {
+            string path = TryGetCacheFilePath(key);
+
+            if (path is null)
+            {
+                return null;
+            }
+
+            try
+            {
+                if (!File.Exists(path))
+                {
+                    return null;
+                }
+
+                byte[] encodedImage = File.ReadAllBytes(path);
+
+                // The last write time is used to track the least recently used files.
+                File.SetLastWriteTimeUtc(path, DateTime.UtcNow);
+
+                return encodedImage;
+            }
+            catch (IOException)
+            {
+                return null;
+            }
+            catch (UnauthorizedAccessException)
+            {
+                return null;
+            }
+        }
+
+        private void TrimDiskCache()
+        {
+            FileInfo[] files = new DirectoryInfo(this.diskCacheDirectory).GetFiles("*" + CacheFileExtension);
+
+            long totalSize = files.Sum(file => file.Length);
+
+            if (totalSize <= MaxDiskCacheSize)
+            {
+                return;
+            }
+
+            foreach (FileInfo file in files.OrderBy(file => file.LastWriteTimeUtc))
+            {
+                long fileSize = file.Length;
+
+                file.Delete();
+                totalSize -= fileSize;
+
+                if (totalSize <= MaxDiskCacheSize)
+                {
+                    break;
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,59 @@
+﻿////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-mozjpeg, a FileType plugin for Paint.NET
+// that saves JPEG images using the mozjpeg encoder.
+//
+// Copyright (c) 2021, 2022 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+using System;
+using System.Globalization;
+
+namespace MozJpegFileType.Caching
+{
+    internal readonly struct EncodeCacheKey : IEquatable<EncodeCacheKey>
+    {
+        private readonly ulong low;
+        private readonly ulong high;
+
+        public EncodeCacheKey(ulong low, ulong high)
+        {
+            this.low = low;
+            this.high = high;
+        }
+
+        public override bool Equals(object obj)
+        {
+            return obj is EncodeCacheKey other && Equals(other);
+        }
+
+        public bool Equals(EncodeCacheKey other)
+        {
+            return this.low == other.low && this.high == other.high;
+        }
+
+        public override int GetHashCode()
+        {
+            return HashCode.Combine(this.low, this.high);
+        }
+
+        public override string ToString()
+        {
+            return this.high.ToString("x16", CultureInfo.InvariantCulture) + this.low.ToString("x16", CultureInfo.InvariantCulture);
+        }
+
+        public static bool operator ==(EncodeCacheKey left, EncodeCacheKey right)
+        {
+            return left.Equals(right);
+        }
+
+        public static bool operator !=(EncodeCacheKey left, EncodeCacheKey right)
+        {
+            return !(left == right);
+        }
+    }
+}
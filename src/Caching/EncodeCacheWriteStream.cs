@@ -0,0 +1,131 @@
+﻿////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-mozjpeg, a FileType plugin for Paint.NET
+// that saves JPEG images using the mozjpeg encoder.
+//
+// Copyright (c) 2021, 2022 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+using System;
+using System.IO;
+
+namespace MozJpegFileType.Caching
+{
+    /// <summary>
+    /// A write-only stream that passes the encoded image through to the output stream,
+    /// and keeps a copy for the cache while the image is not larger than the maximum entry size.
+    /// </summary>
+    internal sealed class EncodeCacheWriteStream : Stream
+    {
+        private const int InitialCapacity = 64 * 1024;
+
+        private readonly Stream output;
+        private readonly int maxCapturedLength;
+        private byte[] capturedData;
+        private int capturedLength;
+
+        public EncodeCacheWriteStream(Stream output, int maxCapturedLength)
+        {
+            if (output is null)
+            {
+                throw new ArgumentNullException(nameof(output));
+            }
+
+            this.output = output;
+            this.maxCapturedLength = maxCapturedLength;
+            this.capturedData = new byte[Math.Min(InitialCapacity, maxCapturedLength)];
+            this.capturedLength = 0;
+        }
+
+        public override bool CanRead => false;
+
+        public override bool CanSeek => false;
+
+        public override bool CanWrite => true;
+
+        public override long Length => throw new NotSupportedException();
+
+        public override long Position
+        {
+            get => throw new NotSupportedException();
+            set => throw new NotSupportedException();
+        }
+
+        /// <summary>
+        /// Gets the data that was written to the stream, without copying it.
+        /// </summary>
+        /// <param name="data">The data that was written to the stream.</param>
+        /// <returns>
+        /// <see langword="true"/> if the data was captured; otherwise, <see langword="false"/>
+        /// if it was larger than the maximum entry size.
+        /// </returns>
+        public bool TryGetCapturedData(out ArraySegment<byte> data)
+        {
+            if (this.capturedData is null)
+            {
+                data = default;
+                return false;
+            }
+
+            data = new ArraySegment<byte>(this.capturedData, 0, this.capturedLength);
+            return true;
+        }
+
+        public override void Flush()
+        {
+            this.output.Flush();
+        }
+
+        public override int Read(byte[] buffer, int offset, int count)
+        {
+            throw new NotSupportedException();
+        }
+
+        public override long Seek(long offset, SeekOrigin origin)
+        {
+            throw new NotSupportedException();
+        }
+
+        public override void SetLength(long value)
+        {
+            throw new NotSupportedException();
+        }
+
+        public override void Write(byte[] buffer, int offset, int count)
+        {
+            Write(new ReadOnlySpan<byte>(buffer, offset, count));
+        }
+
+        public override void Write(ReadOnlySpan<byte> buffer)
+        {
+            this.output.Write(buffer);
+
+            if (this.capturedData != null)
+            {
+                long requiredLength = (long)this.capturedLength + buffer.Length;
+
+                if (requiredLength > this.maxCapturedLength)
+                {
+                    // The image is too large to cache, release the data that has already been captured.
+                    this.capturedData = null;
+                    this.capturedLength = 0;
+                    return;
+                }
+
+                if (requiredLength > this.capturedData.Length)
+                {
+                    long newCapacity = Math.Min(Math.Max((long)this.capturedData.Length * 2, requiredLength), this.maxCapturedLength);
+
+                    Array.Resize(ref this.capturedData, (int)newCapacity);
+                }
+
+                buffer.CopyTo(this.capturedData.AsSpan(this.capturedLength));
+                this.capturedLength += buffer.Length;
+            }
+        }
+    }
+}
@@ -0,0 +1,49 @@
+﻿////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-mozjpeg, a FileType plugin for Paint.NET
+// that saves JPEG images using the mozjpeg encoder.
+//
+// Copyright (c) 2021, 2022 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+namespace MozJpegFileType
+{
+    internal enum EncodingMode
+    {
+        /// <summary>
+        /// Uses the chroma subsampling and progressive settings chosen by the user.
+        /// </summary>
+        Standard,
+
+        /// <summary>
+        /// Tries each chroma subsampling and progressive combination, and keeps the smallest file.
+        /// </summary>
+        /// <remarks>
+        /// The combinations are encoded in parallel, one per processor core, so this takes
+        /// longer than the standard mode on machines with fewer than six cores.
+        /// </remarks>
+        Automatic,
+
+        /// <summary>
+        /// Writes a baseline image in a single pass using the standard Huffman tables.
+        /// </summary>
+        /// <remarks>
+        /// This is faster and uses less memory, but the file is larger.
+        /// </remarks>
+        Fast,
+
+        /// <summary>
+        /// Writes a fast mode image and keeps the encoded rows, so that saving the same
+        /// document again only re-encodes the rows of the image that changed.
+        /// </summary>
+        /// <remarks>
+        /// The image has a restart marker after every MCU row and is encoded in memory, and the
+        /// encoded rows are kept until the document is closed. This uses more memory than <see cref="Fast"/>.
+        /// </remarks>
+        FastIncremental
+    }
+}
@@ -16,63 +16,30 @@ namespace MozJpegFileType
 {
     internal static class ImageTransform
     {
-        internal static unsafe void FlipHorizontal(Surface surface)
+        internal static void FlipHorizontal(Surface surface)
         {
-            int lastColumn = surface.Width - 1;
-            int flipWidth = surface.Width / 2;
-
-            for (int y = 0; y < surface.Height; y++)
-            {
-                for (int x = 0; x < flipWidth; x++)
-                {
-                    int sampleColumn = lastColumn - x;
-
-                    ColorBgra temp = surface[x, y];
-                    surface[x, y] = surface[sampleColumn, y];
-                    surface[sampleColumn, y] = temp;
-                }
-            }
+            MozJpegNative.FlipHorizontal(surface);
         }
 
-        internal static unsafe void FlipVertical(Surface surface)
+        internal static void FlipVertical(Surface surface)
         {
-            int lastRow = surface.Height - 1;
-            int flipHeight = surface.Height / 2;
+            MozJpegNative.FlipVertical(surface);
+        }
 
-            for (int x = 0; x < surface.Width; x++)
+        internal static void Rotate90CCW(ref Surface surface)
+        {
+            if (surface.Width == surface.Height)
             {
-                for (int y = 0; y < flipHeight; y++)
-                {
-                    int sampleRow = lastRow - y;
-
-                    ColorBgra temp = surface[x, y];
-                    surface[x, y] = surface[x, sampleRow];
-                    surface[x, sampleRow] = temp;
-                }
+                MozJpegNative.Rotate90CCW(surface, null);
+                return;
             }
-        }
 
-        internal static unsafe void Rotate90CCW(ref Surface surface)
-        {
             Surface temp = null;
             try
             {
                 temp = new Surface(surface.Height, surface.Width);
 
-                int lastColumn = surface.Width - 1;
-
-                for (int y = 0; y < temp.Height; y++)
-                {
-                    ColorBgra* dstPtr = temp.GetRowPointerUnchecked(y);
-
-                    for (int x = 0; x < temp.Width; x++)
-                    {
-                        ColorBgra pixel = surface[lastColumn - y, x];
-
-                        dstPtr->Bgra = pixel.Bgra;
-                        dstPtr++;
-                    }
-                }
+                MozJpegNative.Rotate90CCW(surface, temp);
 
                 surface.Dispose();
                 surface = temp;
@@ -84,41 +51,25 @@ namespace MozJpegFileType
             }
         }
 
-        internal static unsafe void Rotate180(Surface surface)
+        internal static void Rotate180(Surface surface)
         {
-            int lastColumn = surface.Width - 1;
-            int lastRow = surface.Height - 1;
+            MozJpegNative.Rotate180(surface);
+        }
 
-            for (int y = 0; y < surface.Height; y++)
+        internal static void Rotate270CCW(ref Surface surface)
+        {
+            if (surface.Width == surface.Height)
             {
-                for (int x = 0; x < surface.Width; x++)
-                {
-                    surface[x, y] = surface[lastColumn - x, lastRow - y];
-                }
+                MozJpegNative.Rotate270CCW(surface, null);
+                return;
             }
-        }
 
-        internal static unsafe void Rotate270CCW(ref Surface surface)
-        {
             Surface temp = null;
             try
             {
                 temp = new Surface(surface.Height, surface.Width);
 
-                int lastRow = surface.Height - 1;
-
-                for (int y = 0; y < temp.Height; y++)
-                {
-                    ColorBgra* dstPtr = temp.GetRowPointerUnchecked(y);
-
-                    for (int x = 0; x < temp.Width; x++)
-                    {
-                        ColorBgra pixel = surface[y, lastRow - x];
-
-                        dstPtr->Bgra = pixel.Bgra;
-                        dstPtr++;
-                    }
-                }
+                MozJpegNative.Rotate270CCW(surface, temp);
 
                 surface.Dispose();
                 surface = temp;
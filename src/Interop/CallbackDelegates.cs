@@ -36,4 +36,18 @@ namespace MozJpegFileType.Interop
     [UnmanagedFunctionPointer(CallingConvention.StdCall)]
     [return: MarshalAs(UnmanagedType.U1)]
     internal delegate bool SetMetadataCallback(IntPtr data, int size, MetadataType type);
+
+    [UnmanagedFunctionPointer(CallingConvention.StdCall)]
+    internal delegate OutputPixelFormat SelectOutputFormatCallback(int componentCount);
+
+    [UnmanagedFunctionPointer(CallingConvention.StdCall)]
+    internal delegate IntPtr AllocatePlaneCallback(int planeIndex, int width, int height, out int stride);
+
+    [UnmanagedFunctionPointer(CallingConvention.StdCall)]
+    [return: MarshalAs(UnmanagedType.U1)]
+    internal delegate bool DecodeProgressCallback(int progress, int scanNumber, uint rowsProduced);
+
+    [UnmanagedFunctionPointer(CallingConvention.StdCall)]
+    [return: MarshalAs(UnmanagedType.U1)]
+    internal delegate bool ConsumeRowsCallback(IntPtr rows, uint firstRow, int rowCount, UIntPtr stride, ulong firstRowOffset);
 }
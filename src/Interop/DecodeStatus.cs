@@ -19,6 +19,7 @@ namespace MozJpegFileType.Interop
         OutOfMemory,
         JpegLibraryError,
         CallbackError,
-        UserCanceled
+        UserCanceled,
+        UnsupportedOutputFormat
     }
 }
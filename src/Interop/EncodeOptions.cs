@@ -14,6 +14,7 @@ using System.Runtime.InteropServices;
 
 namespace MozJpegFileType.Interop
 {
+    // This must be kept in sync with the EncodeOptions structure in MozJpegFileTypeIO.h.
     [StructLayout(LayoutKind.Sequential)]
     internal struct EncodeOptions
     {
@@ -21,5 +22,10 @@ namespace MozJpegFileType.Interop
         public ChromaSubsampling chromaSubsampling;
         [MarshalAs(UnmanagedType.U1)]
         public bool progressive;
+        [MarshalAs(UnmanagedType.U1)]
+        public bool autoSelect;
+        public float autoMinimumPsnr;
+        [MarshalAs(UnmanagedType.U1)]
+        public bool singlePass;
     }
 }
@@ -0,0 +1,42 @@
+﻿////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-mozjpeg, a FileType plugin for Paint.NET
+// that saves JPEG images using the mozjpeg encoder.
+//
+// Copyright (c) 2021, 2022 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+using Microsoft.Win32.SafeHandles;
+using System.Runtime.InteropServices;
+
+namespace MozJpegFileType.Interop
+{
+    internal sealed class IncrementalEncoderHandle : SafeHandleZeroOrMinusOneIsInvalid
+    {
+        private IncrementalEncoderHandle() : base(true)
+        {
+        }
+
+        protected override bool ReleaseHandle()
+        {
+            if (RuntimeInformation.ProcessArchitecture == Architecture.X64)
+            {
+                MozJpeg_X64.DestroyIncrementalEncoder(handle);
+            }
+            else if (RuntimeInformation.ProcessArchitecture == Architecture.Arm64)
+            {
+                MozJpeg_Arm64.DestroyIncrementalEncoder(handle);
+            }
+            else if (RuntimeInformation.ProcessArchitecture == Architecture.X86)
+            {
+                MozJpeg_X86.DestroyIncrementalEncoder(handle);
+            }
+
+            return true;
+        }
+    }
+}
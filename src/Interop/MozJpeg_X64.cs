@@ -10,6 +10,7 @@
 //
 ////////////////////////////////////////////////////////////////////////
 
+using System;
 using System.Runtime.InteropServices;
 
 namespace MozJpegFileType.Interop
@@ -21,15 +22,64 @@ namespace MozJpegFileType.Interop
         [DllImport(DllName)]
         internal static extern unsafe DecodeStatus ReadImage(
            ReadCallbacks callbacks,
+           [In] ref DecodeOptions decodeOptions,
+           DecodeStatistics* statistics,
+           ref JpegLibraryErrorInfo errorInfo);
+
+        [DllImport(DllName)]
+        internal static extern unsafe DecodeStatus ReadImageRows(
+           ReadCallbacks callbacks,
+           [In] ref DecodeOptions decodeOptions,
+           RowBandOptions rowBands,
+           DecodeStatistics* statistics,
            ref JpegLibraryErrorInfo errorInfo);
 
         [DllImport(DllName)]
         internal static extern unsafe EncodeStatus WriteImage(
+            [In] ref BitmapData bitmapData,
+            [In] ref EncodeOptions encodeOptions,
+            [MarshalAs(UnmanagedType.CustomMarshaler, MarshalTypeRef = typeof(MetadataCustomMarshaler))] MetadataParams metadata,
+            EncodeStatistics* statistics,
+            ref JpegLibraryErrorInfo errorInfo,
+            [MarshalAs(UnmanagedType.FunctionPtr)] ProgressCallback progressCallback,
+            [MarshalAs(UnmanagedType.FunctionPtr)] WriteCallback writeCallback);
+
+        [DllImport(DllName)]
+        internal static extern EncodeStatus RecompressJpeg(
+            ReadCallbacks callbacks,
+            [In] ref RecompressOptions options,
+            ref JpegLibraryErrorInfo errorInfo,
+            [MarshalAs(UnmanagedType.FunctionPtr)] WriteCallback writeCallback);
+
+        [DllImport(DllName)]
+        internal static extern IncrementalEncoderHandle CreateIncrementalEncoder();
+
+        [DllImport(DllName)]
+        internal static extern void DestroyIncrementalEncoder(IntPtr encoder);
+
+        [DllImport(DllName)]
+        internal static extern unsafe EncodeStatus WriteImageIncremental(
+            IncrementalEncoderHandle encoder,
             [In] ref BitmapData bitmapData,
             [In] ref EncodeOptions encodeOptions,
             [MarshalAs(UnmanagedType.CustomMarshaler, MarshalTypeRef = typeof(MetadataCustomMarshaler))] MetadataParams metadata,
             ref JpegLibraryErrorInfo errorInfo,
             [MarshalAs(UnmanagedType.FunctionPtr)] ProgressCallback progressCallback,
             [MarshalAs(UnmanagedType.FunctionPtr)] WriteCallback writeCallback);
+
+        [DllImport(DllName)]
+        internal static extern TransformStatus FlipImageHorizontal([In] ref BitmapData image);
+
+        [DllImport(DllName)]
+        internal static extern TransformStatus FlipImageVertical([In] ref BitmapData image);
+
+        [DllImport(DllName)]
+        internal static extern TransformStatus RotateImage180([In] ref BitmapData image);
+
+        [DllImport(DllName)]
+        internal static extern unsafe TransformStatus RotateImage90CCW([In] ref BitmapData source, BitmapData* destination);
+
+        [DllImport(DllName)]
+        internal static extern unsafe TransformStatus RotateImage270CCW([In] ref BitmapData source, BitmapData* destination);
     }
 }
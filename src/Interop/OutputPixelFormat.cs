@@ -0,0 +1,24 @@
+﻿////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-mozjpeg, a FileType plugin for Paint.NET
+// that saves JPEG images using the mozjpeg encoder.
+//
+// Copyright (c) 2021, 2022 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+namespace MozJpegFileType.Interop
+{
+    // This must be kept in sync with the OutputPixelFormat enumeration in MozJpegFileTypeIO.h.
+    internal enum OutputPixelFormat : int
+    {
+        Bgra32 = 0,
+        Bgr24,
+        Rgba32,
+        Gray8,
+        PlanarYCbCr
+    }
+}
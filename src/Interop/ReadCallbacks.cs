@@ -28,5 +28,14 @@ namespace MozJpegFileType.Interop
 
         [MarshalAs(UnmanagedType.FunctionPtr)]
         public SetMetadataCallback setIccProfile;
+
+        [MarshalAs(UnmanagedType.FunctionPtr)]
+        public SelectOutputFormatCallback selectOutputFormat;
+
+        [MarshalAs(UnmanagedType.FunctionPtr)]
+        public AllocatePlaneCallback allocatePlane;
+
+        [MarshalAs(UnmanagedType.FunctionPtr)]
+        public DecodeProgressCallback progress;
     }
 }
@@ -0,0 +1,26 @@
+﻿////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-mozjpeg, a FileType plugin for Paint.NET
+// that saves JPEG images using the mozjpeg encoder.
+//
+// Copyright (c) 2021, 2022 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+
+using System.Runtime.InteropServices;
+
+namespace MozJpegFileType.Interop
+{
+    // This must be kept in sync with the RecompressOptions structure in MozJpegFileTypeIO.h.
+    [StructLayout(LayoutKind.Sequential)]
+    internal struct RecompressOptions
+    {
+        public int quality;
+        [MarshalAs(UnmanagedType.U1)]
+        public bool progressive;
+    }
+}
@@ -10,6 +10,7 @@
 //
 ////////////////////////////////////////////////////////////////////////
 
+using MozJpegFileType.Caching;
 using MozJpegFileType.Exif;
 using MozJpegFileType.Interop;
 using MozJpegFileType.Xmp;
@@ -21,15 +22,30 @@ using PaintDotNet.Rendering;
 using System;
 using System.Collections.Generic;
 using System.IO;
+using System.Runtime.CompilerServices;
 using System.Text;
 
 namespace MozJpegFileType
 {
     internal static class MozJpegFile
     {
+        /// <summary>
+        /// The minimum PSNR that the automatic encoding mode requires before it picks a smaller file.
+        /// </summary>
+        /// <remarks>
+        /// This keeps the automatic mode from choosing 4:2:0 chroma subsampling for images with
+        /// fine colored detail, such as text and line art.
+        /// </remarks>
+        private const float AutoSelectMinimumPsnr = 35.0f;
+
+        /// <summary>
+        /// The incremental encoder state of each document that has been saved in the fast encoding mode.
+        /// </summary>
+        private static readonly ConditionalWeakTable<Document, IncrementalEncoderHandle> incrementalEncoders = new ConditionalWeakTable<Document, IncrementalEncoderHandle>();
+
         public static Document Load(Stream input, IArrayPoolService arrayPool)
         {
-            MozJpegLoadState loadState = MozJpegNative.Load(input, arrayPool);
+            MozJpegLoadState loadState = MozJpegNative.Load(input, DecodeQuality.Accurate, null, arrayPool);
 
             Surface surface = loadState.Surface;
 
@@ -61,6 +77,7 @@ namespace MozJpegFileType
             int quality,
             ChromaSubsampling chromaSubsampling,
             bool progressive,
+            EncodingMode encodingMode,
             ProgressEventHandler progressCallback,
             IArrayPoolService arrayPool)
         {
@@ -76,14 +93,68 @@ namespace MozJpegFileType
 
             MetadataParams metadata = CreateMozJpegMetadata(input);
 
-            MozJpegNative.Save(scratchSurface,
-                               output,
-                               quality,
-                               chromaSubsampling,
-                               progressive,
-                               metadata,
-                               progressCallback,
-                               arrayPool);
+            EncodeOptions encodeOptions = new EncodeOptions
+            {
+                quality = quality,
+                chromaSubsampling = chromaSubsampling,
+                progressive = progressive,
+                autoSelect = encodingMode == EncodingMode.Automatic,
+                autoMinimumPsnr = AutoSelectMinimumPsnr,
+                singlePass = encodingMode == EncodingMode.Fast || encodingMode == EncodingMode.FastIncremental
+            };
+
+            bool incremental = encodingMode == EncodingMode.FastIncremental;
+
+            // Saving a document that has not changed since the last save reuses the previous output.
+            EncodeCacheKey cacheKey = EncodeCache.CreateKey(scratchSurface, encodeOptions, incremental, metadata);
+
+            if (EncodeCache.Instance.TryWriteTo(cacheKey, output))
+            {
+                progressCallback?.Invoke(null, new ProgressEventArgs(100, true));
+                return;
+            }
+
+            // The encoded image is written directly to the output, a copy is kept
+            // for the cache if it is not larger than the maximum entry size.
+            using (EncodeCacheWriteStream cacheWriteStream = new EncodeCacheWriteStream(output, EncodeCache.MaxEntrySize))
+            {
+                Encode(input, scratchSurface, cacheWriteStream, encodeOptions, incremental, metadata, progressCallback, arrayPool);
+
+                if (cacheWriteStream.TryGetCapturedData(out ArraySegment<byte> encodedImage))
+                {
+                    EncodeCache.Instance.Add(cacheKey, encodedImage);
+                }
+            }
+        }
+
+        private static void Encode(
+            Document document,
+            Surface surface,
+            Stream output,
+            EncodeOptions encodeOptions,
+            bool incremental,
+            MetadataParams metadata,
+            ProgressEventHandler progressCallback,
+            IArrayPoolService arrayPool)
+        {
+            if (incremental)
+            {
+                // The incremental mode uses fixed Huffman tables, so the rows that did not change
+                // since the previous save of the document can be copied from that save.
+                IncrementalEncoderHandle encoder = incrementalEncoders.GetValue(document,
+                                                                                 (_) => MozJpegNative.CreateIncrementalEncoder());
+
+                if (!encoder.IsInvalid)
+                {
+                    lock (encoder)
+                    {
+                        MozJpegNative.SaveIncremental(encoder, surface, output, encodeOptions, metadata, progressCallback, arrayPool);
+                    }
+                    return;
+                }
+            }
+
+            MozJpegNative.Save(surface, output, encodeOptions, metadata, progressCallback, arrayPool);
         }
 
         private static void AddMetadataToDocument(Document document,
@@ -15,6 +15,7 @@ using PaintDotNet.AppModel;
 using PaintDotNet.IndirectUI;
 using PaintDotNet.PropertySystem;
 using System;
+using System.Collections.Generic;
 using System.IO;
 
 namespace MozJpegFileType
@@ -47,7 +48,8 @@ namespace MozJpegFileType
         {
             Quality,
             ChromaSubsampling,
-            Progressive
+            Progressive,
+            EncodingMode
         }
 
         /// <summary>
@@ -59,10 +61,24 @@ namespace MozJpegFileType
             {
                 new Int32Property(PropertyNames.Quality, 75, 0, 100, false),
                 CreateChromaSubsampling(),
-                new BooleanProperty(PropertyNames.Progressive, false, false)
+                new BooleanProperty(PropertyNames.Progressive, false, false),
+                StaticListChoiceProperty.CreateForEnum(PropertyNames.EncodingMode, EncodingMode.Standard, false)
             };
 
-            return new PropertyCollection(props);
+            List<PropertyCollectionRule> rules = new List<PropertyCollectionRule>
+            {
+                new ReadOnlyBoundToValueRule<object, StaticListChoiceProperty>(PropertyNames.ChromaSubsampling,
+                                                                               PropertyNames.EncodingMode,
+                                                                               EncodingMode.Automatic,
+                                                                               false),
+                // Progressive only applies to the standard encoding mode.
+                new ReadOnlyBoundToValueRule<object, StaticListChoiceProperty>(PropertyNames.Progressive,
+                                                                               PropertyNames.EncodingMode,
+                                                                               EncodingMode.Standard,
+                                                                               true)
+            };
+
+            return new PropertyCollection(props, rules);
 
             StaticListChoiceProperty CreateChromaSubsampling()
             {
@@ -107,6 +123,14 @@ namespace MozJpegFileType
             progressivePCI.ControlProperties[ControlInfoPropertyNames.DisplayName].Value = string.Empty;
             progressivePCI.ControlProperties[ControlInfoPropertyNames.Description].Value = "Progressive";
 
+            PropertyControlInfo encodingModePCI = configUI.FindControlForPropertyName(PropertyNames.EncodingMode);
+            encodingModePCI.ControlProperties[ControlInfoPropertyNames.DisplayName].Value = "Encoding Mode";
+            encodingModePCI.ControlProperties[ControlInfoPropertyNames.Description].Value = string.Empty;
+            encodingModePCI.SetValueDisplayName(EncodingMode.Standard, "Standard");
+            encodingModePCI.SetValueDisplayName(EncodingMode.Automatic, "Automatic (Smallest File)");
+            encodingModePCI.SetValueDisplayName(EncodingMode.Fast, "Fast (Single Pass)");
+            encodingModePCI.SetValueDisplayName(EncodingMode.FastIncremental, "Fast (Incremental Re-save)");
+
             return configUI;
         }
 
@@ -130,6 +154,7 @@ namespace MozJpegFileType
             int quality = token.GetProperty<Int32Property>(PropertyNames.Quality).Value;
             ChromaSubsampling chromaSubsampling = (ChromaSubsampling)token.GetProperty(PropertyNames.ChromaSubsampling).Value;
             bool progressive = token.GetProperty<BooleanProperty>(PropertyNames.Progressive).Value;
+            EncodingMode encodingMode = (EncodingMode)token.GetProperty(PropertyNames.EncodingMode).Value;
 
             MozJpegFile.Save(input,
                              output,
@@ -137,6 +162,7 @@ namespace MozJpegFileType
                              quality,
                              chromaSubsampling,
                              progressive,
+                             encodingMode,
                              progressCallback,
                              this.arrayPoolService);
         }
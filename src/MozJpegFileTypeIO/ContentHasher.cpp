@@ -0,0 +1,239 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-mozjpeg, a FileType plugin for Paint.NET
+// that saves JPEG images using the mozjpeg encoder.
+//
+// Copyright (c) 2021, 2022 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "ContentHasher.h"
+#include <string.h>
+
+namespace
+{
+    constexpr size_t StripesPerBlock = 32;
+    // Stripe N of a block uses the secret values starting at N, the values after
+    // those are used to scramble the accumulators at the end of each block.
+    constexpr size_t ScrambleSecretOffset = StripesPerBlock + ContentHasher::LaneCount;
+    constexpr size_t SecretLength = ScrambleSecretOffset + ContentHasher::LaneCount;
+
+    constexpr uint64_t Prime32_1 = 0x9E3779B1ULL;
+    constexpr uint64_t Prime64_1 = 0x9E3779B185EBCA87ULL;
+    constexpr uint64_t Prime64_2 = 0xC2B2AE3D27D4EB4FULL;
+
+    struct Secret
+    {
+        uint64_t values[SecretLength];
+    };
+
+    constexpr Secret CreateSecret()
+    {
+        // The secret values are generated with SplitMix64 from the same fixed seed as ContentHasher.cs.
+        Secret secret{};
+        uint64_t state = 0x243F6A8885A308D3ULL;
+
+        for (size_t i = 0; i < SecretLength; i++)
+        {
+            state += 0x9E3779B97F4A7C15ULL;
+
+            uint64_t value = state;
+            value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+
+            secret.values[i] = value ^ (value >> 31);
+        }
+
+        return secret;
+    }
+
+    constexpr Secret HashSecret = CreateSecret();
+
+    inline uint64_t RotateLeft(uint64_t value, int count)
+    {
+        return (value << count) | (value >> (64 - count));
+    }
+
+    inline uint64_t ReadUInt64LittleEndian(const uint8_t* data)
+    {
+        uint64_t value = 0;
+
+        for (size_t i = 0; i < sizeof(uint64_t); i++)
+        {
+            value |= static_cast<uint64_t>(data[i]) << (i * 8);
+        }
+
+        return value;
+    }
+
+    inline uint64_t MultiplyHalves(uint64_t key)
+    {
+        return (key & 0xFFFFFFFFULL) * (key >> 32);
+    }
+
+    inline uint64_t Scramble(uint64_t acc, uint64_t secret)
+    {
+        acc ^= acc >> 47;
+        acc ^= secret;
+
+        return acc * Prime32_1;
+    }
+
+    uint64_t MultiplyFold(uint64_t left, uint64_t right)
+    {
+        // The 128-bit product is computed from 32-bit halves, which works on every target architecture.
+        const uint64_t leftLow = left & 0xFFFFFFFFULL;
+        const uint64_t leftHigh = left >> 32;
+        const uint64_t rightLow = right & 0xFFFFFFFFULL;
+        const uint64_t rightHigh = right >> 32;
+
+        const uint64_t lowLow = leftLow * rightLow;
+        const uint64_t highLow = leftHigh * rightLow;
+        const uint64_t lowHigh = leftLow * rightHigh;
+        const uint64_t highHigh = leftHigh * rightHigh;
+
+        const uint64_t cross = (lowLow >> 32) + (highLow & 0xFFFFFFFFULL) + lowHigh;
+
+        const uint64_t productHigh = highHigh + (highLow >> 32) + (cross >> 32);
+        const uint64_t productLow = (cross << 32) | (lowLow & 0xFFFFFFFFULL);
+
+        return productLow ^ productHigh;
+    }
+
+    uint64_t Avalanche(uint64_t value)
+    {
+        value ^= value >> 37;
+        value *= 0x165667919E3779F9ULL;
+        value ^= value >> 32;
+
+        return value;
+    }
+}
+
+ContentHasher::ContentHasher()
+    : pendingStripe(), pendingLength(0), acc{ Prime32_1, Prime64_1, Prime64_2, Prime32_1 ^ Prime64_2 }, stripesInBlock(0), totalLength(0)
+{
+}
+
+void ContentHasher::Append(const void* data, size_t length)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+
+    totalLength += length;
+
+    if (pendingLength > 0)
+    {
+        const size_t bytesToCopy = length < StripeLength - pendingLength ? length : StripeLength - pendingLength;
+
+        memcpy(pendingStripe + pendingLength, bytes, bytesToCopy);
+        pendingLength += bytesToCopy;
+        bytes += bytesToCopy;
+        length -= bytesToCopy;
+
+        if (pendingLength < StripeLength)
+        {
+            return;
+        }
+
+        ProcessStripe(pendingStripe);
+        pendingLength = 0;
+    }
+
+    while (length >= StripeLength)
+    {
+        ProcessStripe(bytes);
+        bytes += StripeLength;
+        length -= StripeLength;
+    }
+
+    if (length > 0)
+    {
+        memcpy(pendingStripe, bytes, length);
+        pendingLength = length;
+    }
+}
+
+void ContentHasher::Append(int32_t value)
+{
+    const uint32_t bits = static_cast<uint32_t>(value);
+    const uint8_t bytes[sizeof(bits)] =
+    {
+        static_cast<uint8_t>(bits),
+        static_cast<uint8_t>(bits >> 8),
+        static_cast<uint8_t>(bits >> 16),
+        static_cast<uint8_t>(bits >> 24)
+    };
+
+    Append(bytes, sizeof(bytes));
+}
+
+void ContentHasher::AppendWithLength(const void* data, size_t length)
+{
+    if (data == nullptr)
+    {
+        Append(-1);
+    }
+    else
+    {
+        Append(static_cast<int32_t>(length));
+        Append(data, length);
+    }
+}
+
+ContentHash ContentHasher::GetHash() const
+{
+    uint64_t a[LaneCount] = { acc[0], acc[1], acc[2], acc[3] };
+
+    // Mix the tail bytes that do not fill a complete stripe.
+    for (size_t i = 0; i < pendingLength; i++)
+    {
+        const uint64_t value = static_cast<uint64_t>(pendingStripe[i]) * Prime64_1;
+        uint64_t& lane = a[i & 3];
+
+        lane = RotateLeft(lane ^ value, 23) * Prime64_2;
+    }
+
+    const uint64_t* secret = HashSecret.values;
+
+    // Both halves fold all of the lanes together, each with different secret values.
+    ContentHash hash;
+    hash.low = Avalanche(MultiplyFold(a[0] ^ secret[0], a[1] ^ secret[1])
+                         + MultiplyFold(a[2] ^ secret[2], a[3] ^ secret[3])
+                         + (totalLength * Prime64_1));
+    hash.high = Avalanche(MultiplyFold(a[0] ^ secret[4], a[1] ^ secret[5])
+                          + MultiplyFold(a[2] ^ secret[6], a[3] ^ secret[7])
+                          + ~(totalLength * Prime64_2));
+
+    return hash;
+}
+
+void ContentHasher::ProcessStripe(const uint8_t* stripe)
+{
+    const uint64_t* secret = HashSecret.values + stripesInBlock;
+
+    const uint64_t data0 = ReadUInt64LittleEndian(stripe);
+    const uint64_t data1 = ReadUInt64LittleEndian(stripe + 8);
+    const uint64_t data2 = ReadUInt64LittleEndian(stripe + 16);
+    const uint64_t data3 = ReadUInt64LittleEndian(stripe + 24);
+
+    // The data of each lane is also added to its neighboring lane, as in XXH3.
+    acc[0] += data1 + MultiplyHalves(data0 ^ secret[0]);
+    acc[1] += data0 + MultiplyHalves(data1 ^ secret[1]);
+    acc[2] += data3 + MultiplyHalves(data2 ^ secret[2]);
+    acc[3] += data2 + MultiplyHalves(data3 ^ secret[3]);
+
+    stripesInBlock++;
+
+    if (stripesInBlock == StripesPerBlock)
+    {
+        for (size_t i = 0; i < LaneCount; i++)
+        {
+            acc[i] = Scramble(acc[i], HashSecret.values[ScrambleSecretOffset + i]);
+        }
+
+        stripesInBlock = 0;
+    }
+}
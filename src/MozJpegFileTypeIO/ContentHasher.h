@@ -0,0 +1,62 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-mozjpeg, a FileType plugin for Paint.NET
+// that saves JPEG images using the mozjpeg encoder.
+//
+// Copyright (c) 2021, 2022 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct ContentHash
+{
+    uint64_t low;
+    uint64_t high;
+};
+
+inline bool operator==(const ContentHash& left, const ContentHash& right)
+{
+    return left.low == right.low && left.high == right.high;
+}
+
+inline bool operator!=(const ContentHash& left, const ContentHash& right)
+{
+    return !(left == right);
+}
+
+// A streaming 128-bit non-cryptographic hash that processes 32-byte stripes with 4 independent lanes.
+// This must be kept in sync with the ContentHasher class in ContentHasher.cs, both produce the same hash for the same data.
+class ContentHasher
+{
+public:
+    ContentHasher();
+
+    void Append(const void* data, size_t length);
+
+    // Appends the value in little-endian byte order.
+    void Append(int32_t value);
+
+    // Appends the length of the data followed by the data, a null pointer is distinct from an empty buffer.
+    void AppendWithLength(const void* data, size_t length);
+
+    ContentHash GetHash() const;
+
+    static constexpr size_t LaneCount = 4;
+    static constexpr size_t StripeLength = LaneCount * sizeof(uint64_t);
+
+private:
+    void ProcessStripe(const uint8_t* stripe);
+
+    uint8_t pendingStripe[StripeLength];
+    size_t pendingLength;
+    uint64_t acc[LaneCount];
+    size_t stripesInBlock;
+    uint64_t totalLength;
+};
@@ -0,0 +1,622 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-mozjpeg, a FileType plugin for Paint.NET
+// that saves JPEG images using the mozjpeg encoder.
+//
+// Copyright (c) 2021, 2022 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "MozJpegFileTypeIO.h"
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <string.h>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define IMAGE_TRANSFORM_SSE2
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#include <arm_neon.h>
+#define IMAGE_TRANSFORM_NEON
+#endif
+
+namespace
+{
+    // A tile of 16 BGRA pixels is 64 bytes wide, which is one cache line on all of the supported processors.
+    constexpr uint32_t TileSize = 16;
+    constexpr uint32_t BlockSize = 4;
+    constexpr uint64_t MinimumParallelPixelCount = 1024 * 1024;
+
+#if defined(IMAGE_TRANSFORM_SSE2)
+    typedef __m128i PixelVector;
+
+    inline PixelVector LoadPixels(const uint32_t* pixels)
+    {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels));
+    }
+
+    inline void StorePixels(uint32_t* pixels, PixelVector value)
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pixels), value);
+    }
+
+    inline PixelVector ReversePixels(PixelVector value)
+    {
+        return _mm_shuffle_epi32(value, _MM_SHUFFLE(0, 1, 2, 3));
+    }
+
+    inline void TransposePixels(PixelVector& row0, PixelVector& row1, PixelVector& row2, PixelVector& row3)
+    {
+        const __m128i temp0 = _mm_unpacklo_epi32(row0, row1);
+        const __m128i temp1 = _mm_unpackhi_epi32(row0, row1);
+        const __m128i temp2 = _mm_unpacklo_epi32(row2, row3);
+        const __m128i temp3 = _mm_unpackhi_epi32(row2, row3);
+
+        row0 = _mm_unpacklo_epi64(temp0, temp2);
+        row1 = _mm_unpackhi_epi64(temp0, temp2);
+        row2 = _mm_unpacklo_epi64(temp1, temp3);
+        row3 = _mm_unpackhi_epi64(temp1, temp3);
+    }
+#elif defined(IMAGE_TRANSFORM_NEON)
+    typedef uint32x4_t PixelVector;
+
+    inline PixelVector LoadPixels(const uint32_t* pixels)
+    {
+        return vld1q_u32(pixels);
+    }
+
+    inline void StorePixels(uint32_t* pixels, PixelVector value)
+    {
+        vst1q_u32(pixels, value);
+    }
+
+    inline PixelVector ReversePixels(PixelVector value)
+    {
+        const uint32x4_t swapped = vrev64q_u32(value);
+
+        return vextq_u32(swapped, swapped, 2);
+    }
+
+    inline void TransposePixels(PixelVector& row0, PixelVector& row1, PixelVector& row2, PixelVector& row3)
+    {
+        const uint32x4x2_t rows01 = vtrnq_u32(row0, row1);
+        const uint32x4x2_t rows23 = vtrnq_u32(row2, row3);
+
+        row0 = vcombine_u32(vget_low_u32(rows01.val[0]), vget_low_u32(rows23.val[0]));
+        row1 = vcombine_u32(vget_low_u32(rows01.val[1]), vget_low_u32(rows23.val[1]));
+        row2 = vcombine_u32(vget_high_u32(rows01.val[0]), vget_high_u32(rows23.val[0]));
+        row3 = vcombine_u32(vget_high_u32(rows01.val[1]), vget_high_u32(rows23.val[1]));
+    }
+#else
+    struct PixelVector
+    {
+        uint32_t values[4];
+    };
+
+    inline PixelVector LoadPixels(const uint32_t* pixels)
+    {
+        PixelVector value;
+        memcpy(value.values, pixels, sizeof(value.values));
+        return value;
+    }
+
+    inline void StorePixels(uint32_t* pixels, PixelVector value)
+    {
+        memcpy(pixels, value.values, sizeof(value.values));
+    }
+
+    inline PixelVector ReversePixels(PixelVector value)
+    {
+        return { { value.values[3], value.values[2], value.values[1], value.values[0] } };
+    }
+
+    inline void TransposePixels(PixelVector& row0, PixelVector& row1, PixelVector& row2, PixelVector& row3)
+    {
+        PixelVector* rows[4] = { &row0, &row1, &row2, &row3 };
+
+        for (int y = 0; y < 4; y++)
+        {
+            for (int x = y + 1; x < 4; x++)
+            {
+                std::swap(rows[y]->values[x], rows[x]->values[y]);
+            }
+        }
+    }
+#endif
+
+    inline uint32_t* GetRow(uint8_t* scan0, ptrdiff_t stride, uint32_t y)
+    {
+        return reinterpret_cast<uint32_t*>(scan0 + (static_cast<ptrdiff_t>(y) * stride));
+    }
+
+    // Calls body with each item index, using multiple threads for large images.
+    // The threads take the next unprocessed item, which balances uneven workloads.
+    template <typename Function>
+    void ParallelFor(uint32_t itemCount, uint64_t pixelCount, const Function& body)
+    {
+        uint32_t threadCount = std::min(std::thread::hardware_concurrency(), itemCount);
+
+        if (pixelCount < MinimumParallelPixelCount || threadCount < 2)
+        {
+            for (uint32_t i = 0; i < itemCount; i++)
+            {
+                body(i);
+            }
+            return;
+        }
+
+        std::atomic<uint32_t> nextItem(0);
+
+        auto worker = [&]()
+        {
+            for (uint32_t i = nextItem++; i < itemCount; i = nextItem++)
+            {
+                body(i);
+            }
+        };
+
+        std::vector<std::thread> threads;
+
+        try
+        {
+            threads.reserve(threadCount - 1);
+
+            for (uint32_t i = 1; i < threadCount; i++)
+            {
+                threads.emplace_back(worker);
+            }
+        }
+        catch (const std::system_error&)
+        {
+            // Any items that the missing threads would have processed are picked up by the other threads.
+        }
+        catch (const std::bad_alloc&)
+        {
+        }
+
+        worker();
+
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+    }
+
+    inline uint32_t GetTileCount(uint32_t length)
+    {
+        return (length + TileSize - 1) / TileSize;
+    }
+
+    void ReverseRow(uint32_t* row, uint32_t width)
+    {
+        uint32_t* left = row;
+        uint32_t* right = row + width;
+
+        while (right - left >= 2 * BlockSize)
+        {
+            right -= BlockSize;
+
+            const PixelVector leftPixels = LoadPixels(left);
+            const PixelVector rightPixels = LoadPixels(right);
+
+            StorePixels(left, ReversePixels(rightPixels));
+            StorePixels(right, ReversePixels(leftPixels));
+
+            left += BlockSize;
+        }
+
+        while (right - left > 1)
+        {
+            right--;
+            std::swap(*left, *right);
+            left++;
+        }
+    }
+
+    // Swaps the pixels of two rows, reversing the order of both.
+    void ReverseSwapRows(uint32_t* first, uint32_t* second, uint32_t width)
+    {
+        uint32_t x = 0;
+
+        for (; x + BlockSize <= width; x += BlockSize)
+        {
+            uint32_t* mirror = second + (width - BlockSize - x);
+
+            const PixelVector firstPixels = LoadPixels(first + x);
+            const PixelVector secondPixels = LoadPixels(mirror);
+
+            StorePixels(first + x, ReversePixels(secondPixels));
+            StorePixels(mirror, ReversePixels(firstPixels));
+        }
+
+        for (; x < width; x++)
+        {
+            std::swap(first[x], second[width - 1 - x]);
+        }
+    }
+
+    void SwapRows(uint8_t* first, uint8_t* second, size_t length)
+    {
+        uint8_t buffer[4096];
+
+        while (length > 0)
+        {
+            const size_t count = std::min(length, sizeof(buffer));
+
+            memcpy(buffer, first, count);
+            memcpy(first, second, count);
+            memcpy(second, buffer, count);
+
+            first += count;
+            second += count;
+            length -= count;
+        }
+    }
+
+    void FlipHorizontal(const BitmapData* image)
+    {
+        const ptrdiff_t stride = image->stride;
+
+        ParallelFor(
+            GetTileCount(image->height),
+            static_cast<uint64_t>(image->width) * image->height,
+            [&](uint32_t tileRow)
+            {
+                const uint32_t lastRow = std::min(image->height, (tileRow + 1) * TileSize);
+
+                for (uint32_t y = tileRow * TileSize; y < lastRow; y++)
+                {
+                    ReverseRow(GetRow(image->scan0, stride, y), image->width);
+                }
+            });
+    }
+
+    void FlipVertical(const BitmapData* image)
+    {
+        const ptrdiff_t stride = image->stride;
+        const uint32_t lastRow = image->height - 1;
+        const uint32_t flipHeight = image->height / 2;
+        const size_t rowLength = static_cast<size_t>(image->width) * sizeof(uint32_t);
+
+        ParallelFor(
+            GetTileCount(flipHeight),
+            static_cast<uint64_t>(image->width) * image->height,
+            [&](uint32_t tileRow)
+            {
+                const uint32_t endRow = std::min(flipHeight, (tileRow + 1) * TileSize);
+
+                for (uint32_t y = tileRow * TileSize; y < endRow; y++)
+                {
+                    SwapRows(reinterpret_cast<uint8_t*>(GetRow(image->scan0, stride, y)),
+                             reinterpret_cast<uint8_t*>(GetRow(image->scan0, stride, lastRow - y)),
+                             rowLength);
+                }
+            });
+    }
+
+    void Rotate180(const BitmapData* image)
+    {
+        const ptrdiff_t stride = image->stride;
+        const uint32_t lastRow = image->height - 1;
+        const uint32_t flipHeight = image->height / 2;
+
+        ParallelFor(
+            GetTileCount(flipHeight),
+            static_cast<uint64_t>(image->width) * image->height,
+            [&](uint32_t tileRow)
+            {
+                const uint32_t endRow = std::min(flipHeight, (tileRow + 1) * TileSize);
+
+                for (uint32_t y = tileRow * TileSize; y < endRow; y++)
+                {
+                    ReverseSwapRows(GetRow(image->scan0, stride, y), GetRow(image->scan0, stride, lastRow - y), image->width);
+                }
+            });
+
+        if ((image->height & 1) != 0)
+        {
+            ReverseRow(GetRow(image->scan0, stride, flipHeight), image->width);
+        }
+    }
+
+    // Writes the transpose of a 4x4 pixel block, row N of the destination is column N of the source.
+    inline void TransposeBlock(const uint32_t* source, ptrdiff_t sourceStride, uint32_t* destination, ptrdiff_t destinationStride)
+    {
+        const uint8_t* sourceBytes = reinterpret_cast<const uint8_t*>(source);
+        uint8_t* destinationBytes = reinterpret_cast<uint8_t*>(destination);
+
+        PixelVector row0 = LoadPixels(reinterpret_cast<const uint32_t*>(sourceBytes));
+        PixelVector row1 = LoadPixels(reinterpret_cast<const uint32_t*>(sourceBytes + sourceStride));
+        PixelVector row2 = LoadPixels(reinterpret_cast<const uint32_t*>(sourceBytes + (2 * sourceStride)));
+        PixelVector row3 = LoadPixels(reinterpret_cast<const uint32_t*>(sourceBytes + (3 * sourceStride)));
+
+        TransposePixels(row0, row1, row2, row3);
+
+        StorePixels(reinterpret_cast<uint32_t*>(destinationBytes), row0);
+        StorePixels(reinterpret_cast<uint32_t*>(destinationBytes + destinationStride), row1);
+        StorePixels(reinterpret_cast<uint32_t*>(destinationBytes + (2 * destinationStride)), row2);
+        StorePixels(reinterpret_cast<uint32_t*>(destinationBytes + (3 * destinationStride)), row3);
+    }
+
+    // A transpose where the rows of either image can be in reverse order,
+    // which turns the transpose into a 90 or 270 degree rotation.
+    struct TransposeParams
+    {
+        uint8_t* sourceScan0;
+        ptrdiff_t sourceStride;
+        uint8_t* destinationScan0;
+        ptrdiff_t destinationStride;
+        uint32_t width;
+        uint32_t height;
+    };
+
+    void TransposeTileRow(const TransposeParams& params, uint32_t tileRow)
+    {
+        const uint32_t firstRow = tileRow * TileSize;
+        const uint32_t lastRow = std::min(firstRow + TileSize, params.height);
+        const uint32_t blockRowEnd = firstRow + ((lastRow - firstRow) & ~(BlockSize - 1));
+        const uint32_t blockColumnEnd = params.width & ~(BlockSize - 1);
+
+        for (uint32_t tileColumn = 0; tileColumn < blockColumnEnd; tileColumn += TileSize)
+        {
+            const uint32_t tileColumnEnd = std::min(tileColumn + TileSize, blockColumnEnd);
+
+            for (uint32_t y = firstRow; y < blockRowEnd; y += BlockSize)
+            {
+                const uint32_t* sourceRow = GetRow(params.sourceScan0, params.sourceStride, y);
+
+                for (uint32_t x = tileColumn; x < tileColumnEnd; x += BlockSize)
+                {
+                    TransposeBlock(
+                        sourceRow + x,
+                        params.sourceStride,
+                        GetRow(params.destinationScan0, params.destinationStride, x) + y,
+                        params.destinationStride);
+                }
+            }
+        }
+
+        for (uint32_t y = firstRow; y < lastRow; y++)
+        {
+            const uint32_t* sourceRow = GetRow(params.sourceScan0, params.sourceStride, y);
+
+            for (uint32_t x = y < blockRowEnd ? blockColumnEnd : 0; x < params.width; x++)
+            {
+                GetRow(params.destinationScan0, params.destinationStride, x)[y] = sourceRow[x];
+            }
+        }
+    }
+
+    void Transpose(const TransposeParams& params)
+    {
+        ParallelFor(
+            GetTileCount(params.height),
+            static_cast<uint64_t>(params.width) * params.height,
+            [&](uint32_t tileRow)
+            {
+                TransposeTileRow(params, tileRow);
+            });
+    }
+
+    // Transposes a square image in place by swapping each block above the diagonal with its mirror below it.
+    void TransposeSquareInPlace(const BitmapData* image)
+    {
+        const uint32_t size = image->width;
+        const ptrdiff_t stride = image->stride;
+        const uint32_t blockEnd = size & ~(BlockSize - 1);
+
+        ParallelFor(
+            GetTileCount(size),
+            static_cast<uint64_t>(size) * size,
+            [&](uint32_t tileRow)
+            {
+                const uint32_t firstRow = tileRow * TileSize;
+                const uint32_t lastRow = std::min(firstRow + TileSize, size);
+                const uint32_t blockRowEnd = std::min(lastRow, blockEnd);
+
+                for (uint32_t tileColumn = firstRow; tileColumn < blockEnd; tileColumn += TileSize)
+                {
+                    const uint32_t tileColumnEnd = std::min(tileColumn + TileSize, blockEnd);
+
+                    for (uint32_t y = firstRow; y < blockRowEnd; y += BlockSize)
+                    {
+                        for (uint32_t x = std::max(tileColumn, y); x < tileColumnEnd; x += BlockSize)
+                        {
+                            uint32_t* upper = GetRow(image->scan0, stride, y) + x;
+                            uint32_t* lower = GetRow(image->scan0, stride, x) + y;
+
+                            PixelVector upper0 = LoadPixels(upper);
+                            PixelVector upper1 = LoadPixels(GetRow(image->scan0, stride, y + 1) + x);
+                            PixelVector upper2 = LoadPixels(GetRow(image->scan0, stride, y + 2) + x);
+                            PixelVector upper3 = LoadPixels(GetRow(image->scan0, stride, y + 3) + x);
+
+                            if (x == y)
+                            {
+                                TransposePixels(upper0, upper1, upper2, upper3);
+
+                                StorePixels(upper, upper0);
+                                StorePixels(GetRow(image->scan0, stride, y + 1) + x, upper1);
+                                StorePixels(GetRow(image->scan0, stride, y + 2) + x, upper2);
+                                StorePixels(GetRow(image->scan0, stride, y + 3) + x, upper3);
+                            }
+                            else
+                            {
+                                PixelVector lower0 = LoadPixels(lower);
+                                PixelVector lower1 = LoadPixels(GetRow(image->scan0, stride, x + 1) + y);
+                                PixelVector lower2 = LoadPixels(GetRow(image->scan0, stride, x + 2) + y);
+                                PixelVector lower3 = LoadPixels(GetRow(image->scan0, stride, x + 3) + y);
+
+                                TransposePixels(upper0, upper1, upper2, upper3);
+                                TransposePixels(lower0, lower1, lower2, lower3);
+
+                                StorePixels(lower, upper0);
+                                StorePixels(GetRow(image->scan0, stride, x + 1) + y, upper1);
+                                StorePixels(GetRow(image->scan0, stride, x + 2) + y, upper2);
+                                StorePixels(GetRow(image->scan0, stride, x + 3) + y, upper3);
+
+                                StorePixels(upper, lower0);
+                                StorePixels(GetRow(image->scan0, stride, y + 1) + x, lower1);
+                                StorePixels(GetRow(image->scan0, stride, y + 2) + x, lower2);
+                                StorePixels(GetRow(image->scan0, stride, y + 3) + x, lower3);
+                            }
+                        }
+                    }
+                }
+
+                // The pixels outside of the 4x4 blocks are swapped one at a time.
+                for (uint32_t y = firstRow; y < lastRow; y++)
+                {
+                    uint32_t* row = GetRow(image->scan0, stride, y);
+
+                    for (uint32_t x = y < blockEnd ? std::max(blockEnd, y + 1) : y + 1; x < size; x++)
+                    {
+                        std::swap(row[x], GetRow(image->scan0, stride, x)[y]);
+                    }
+                }
+            });
+    }
+
+    TransformStatus ValidateImage(const BitmapData* image)
+    {
+        if (image == nullptr || image->scan0 == nullptr)
+        {
+            return TransformStatus::NullParameter;
+        }
+
+        if (image->stride < static_cast<uint64_t>(image->width) * sizeof(uint32_t))
+        {
+            return TransformStatus::InvalidParameter;
+        }
+
+        return TransformStatus::Ok;
+    }
+
+    enum class RotationDirection
+    {
+        Rotate90CCW,
+        Rotate270CCW
+    };
+
+    TransformStatus RotateImage(const BitmapData* source, const BitmapData* destination, RotationDirection direction)
+    {
+        TransformStatus status = ValidateImage(source);
+
+        if (status != TransformStatus::Ok)
+        {
+            return status;
+        }
+
+        if (destination == nullptr)
+        {
+            if (source->width != source->height)
+            {
+                return TransformStatus::InvalidParameter;
+            }
+
+            // A counter-clockwise rotation is a transpose followed by a vertical flip,
+            // and a clockwise rotation is a transpose followed by a horizontal flip.
+            TransposeSquareInPlace(source);
+
+            if (direction == RotationDirection::Rotate90CCW)
+            {
+                FlipVertical(source);
+            }
+            else
+            {
+                FlipHorizontal(source);
+            }
+
+            return TransformStatus::Ok;
+        }
+
+        status = ValidateImage(destination);
+
+        if (status != TransformStatus::Ok)
+        {
+            return status;
+        }
+
+        if (destination->width != source->height || destination->height != source->width)
+        {
+            return TransformStatus::InvalidParameter;
+        }
+
+        TransposeParams params{};
+        params.width = source->width;
+        params.height = source->height;
+
+        if (direction == RotationDirection::Rotate90CCW)
+        {
+            // Reading the destination rows from the bottom up makes the transpose rotate counter-clockwise.
+            params.sourceScan0 = source->scan0;
+            params.sourceStride = source->stride;
+            params.destinationScan0 = destination->scan0 + (static_cast<ptrdiff_t>(destination->height - 1) * destination->stride);
+            params.destinationStride = -static_cast<ptrdiff_t>(destination->stride);
+        }
+        else
+        {
+            // Reading the source rows from the bottom up makes the transpose rotate clockwise.
+            params.sourceScan0 = source->scan0 + (static_cast<ptrdiff_t>(source->height - 1) * source->stride);
+            params.sourceStride = -static_cast<ptrdiff_t>(source->stride);
+            params.destinationScan0 = destination->scan0;
+            params.destinationStride = destination->stride;
+        }
+
+        Transpose(params);
+
+        return TransformStatus::Ok;
+    }
+}
+
+TransformStatus FlipImageHorizontal(const BitmapData* image)
+{
+    TransformStatus status = ValidateImage(image);
+
+    if (status == TransformStatus::Ok)
+    {
+        FlipHorizontal(image);
+    }
+
+    return status;
+}
+
+TransformStatus FlipImageVertical(const BitmapData* image)
+{
+    TransformStatus status = ValidateImage(image);
+
+    if (status == TransformStatus::Ok)
+    {
+        FlipVertical(image);
+    }
+
+    return status;
+}
+
+TransformStatus RotateImage180(const BitmapData* image)
+{
+    TransformStatus status = ValidateImage(image);
+
+    if (status == TransformStatus::Ok)
+    {
+        Rotate180(image);
+    }
+
+    return status;
+}
+
+TransformStatus RotateImage90CCW(const BitmapData* source, const BitmapData* destination)
+{
+    return RotateImage(source, destination, RotationDirection::Rotate90CCW);
+}
+
+TransformStatus RotateImage270CCW(const BitmapData* source, const BitmapData* destination)
+{
+    return RotateImage(source, destination, RotationDirection::Rotate270CCW);
+}
@@ -0,0 +1,562 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-mozjpeg, a FileType plugin for Paint.NET
+// that saves JPEG images using the mozjpeg encoder.
+//
+// Copyright (c) 2021, 2022 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "IncrementalEncoder.h"
+#include "ContentHasher.h"
+#include "JpegEncoderSettings.h"
+#include "JpegErrorHandler.h"
+#include "JpegMemoryDestinationManager.h"
+#include "JpegMetadataWriter.h"
+#include "JpegEncoderProgress.h"
+#include <algorithm>
+#include <new>
+#include <string.h>
+#include <vector>
+
+// The previous save of a document, split into the entropy-coded data of each MCU row.
+struct IncrementalEncoder
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    int quality = 0;
+    ChromaSubsampling chromaSubsampling = ChromaSubsampling::Subsampling420;
+    ContentHash metadataHash{};
+    uint32_t bandHeight = 0;
+    // The file up to the end of the SOS marker segment.
+    std::vector<uint8_t> header;
+    // The entropy-coded data of each MCU row, without the restart markers.
+    std::vector<std::vector<uint8_t>> bands;
+    std::vector<ContentHash> bandHashes;
+    bool valid = false;
+};
+
+namespace
+{
+    constexpr uint8_t MarkerPrefix = 0xFF;
+    constexpr uint8_t FirstRestartMarker = 0xD0;
+    constexpr uint8_t LastRestartMarker = 0xD7;
+    constexpr uint8_t EndOfImageMarker = 0xD9;
+    constexpr uint8_t StartOfScanMarker = 0xDA;
+
+    ContentHash HashBand(const BitmapData* image, uint32_t firstRow, uint32_t rowCount)
+    {
+        ContentHasher hasher;
+        const size_t rowLength = static_cast<size_t>(image->width) * 4;
+
+        for (uint32_t y = firstRow; y < firstRow + rowCount; y++)
+        {
+            hasher.Append(image->scan0 + (static_cast<size_t>(y) * image->stride), rowLength);
+        }
+
+        return hasher.GetHash();
+    }
+
+    ContentHash HashMetadata(const MetadataParams* metadata)
+    {
+        ContentHasher hasher;
+
+        if (metadata != nullptr)
+        {
+            hasher.AppendWithLength(metadata->exif, metadata->exifSize);
+            hasher.AppendWithLength(metadata->iccProfile, metadata->iccProfileSize);
+            hasher.AppendWithLength(metadata->standardXmp, metadata->standardXmpSize);
+            hasher.Append(static_cast<int32_t>(metadata->extendedXmpBlockCount));
+
+            for (size_t i = 0; i < metadata->extendedXmpBlockCount; i++)
+            {
+                hasher.AppendWithLength(metadata->extendedXmpBlocks[i].data, metadata->extendedXmpBlocks[i].length);
+            }
+        }
+
+        return hasher.GetHash();
+    }
+
+    struct MemoryDestinationHolder
+    {
+        MemoryDestination destination{};
+
+        ~MemoryDestinationHolder()
+        {
+            FreeMemoryDestination(&destination);
+        }
+    };
+
+    EncodeStatus EncodeToMemory(
+        const BitmapData* image,
+        int quality,
+        ChromaSubsampling chromaSubsampling,
+        const MetadataParams* metadata,
+        MemoryDestination* output,
+        JpegLibraryErrorInfo* errorInfo,
+        ProgressCallback progressCallback,
+        uint32_t* bandHeight)
+    {
+        JpegErrorContext errorContext{};
+        jpeg_compress_struct cinfo{};
+
+        cinfo.err = jpeg_std_error(&errorContext.mgr);
+        cinfo.err->error_exit = error_exit;
+        memset(errorContext.messageBuffer, 0, _countof(errorContext.messageBuffer));
+
+        if (setjmp(errorContext.setjmpBuffer))
+        {
+            // This block will be jumped to if the JPEG error_exit method is called.
+            jpeg_destroy_compress(&cinfo);
+
+            HandleErrorMessage(errorContext, errorInfo);
+            return EncodeStatus::JpegLibraryError;
+        }
+
+        jpeg_create_compress(&cinfo);
+
+        InitializeMemoryDestinationManager(&cinfo, output);
+
+        // The bands are spliced together, so they must use the same fixed Huffman tables.
+        SetEncoderSettings(&cinfo, image, quality, chromaSubsampling, false, true);
+
+        // A restart marker after every MCU row resets the DC predictors and aligns
+        // the entropy-coded data to a byte boundary, so each row can be replaced on its own.
+        cinfo.restart_in_rows = 1;
+
+        jpeg_start_compress(&cinfo, true);
+
+        if (bandHeight != nullptr)
+        {
+            *bandHeight = static_cast<uint32_t>(cinfo.max_v_samp_factor * DCTSIZE);
+        }
+
+        if (metadata != nullptr)
+        {
+            WriteMetadata(&cinfo, metadata);
+        }
+
+        if (!WriteScanlines(&cinfo, image, progressCallback))
+        {
+            jpeg_destroy_compress(&cinfo);
+
+            return EncodeStatus::UserCanceled;
+        }
+
+        jpeg_finish_compress(&cinfo);
+        jpeg_destroy_compress(&cinfo);
+
+        return EncodeStatus::Ok;
+    }
+
+    // Finds the end of the SOS marker segment, which is where the entropy-coded data starts.
+    bool TryFindScanData(const uint8_t* data, size_t size, size_t* scanDataOffset)
+    {
+        // Skip the SOI marker.
+        size_t offset = 2;
+
+        while (offset + 4 <= size)
+        {
+            if (data[offset] != MarkerPrefix)
+            {
+                return false;
+            }
+
+            const uint8_t marker = data[offset + 1];
+
+            if (marker == MarkerPrefix)
+            {
+                // Fill byte.
+                offset++;
+                continue;
+            }
+
+            const size_t segmentLength = (static_cast<size_t>(data[offset + 2]) << 8) | data[offset + 3];
+
+            if (marker == StartOfScanMarker)
+            {
+                *scanDataOffset = offset + 2 + segmentLength;
+
+                return *scanDataOffset <= size;
+            }
+
+            offset += 2 + segmentLength;
+        }
+
+        return false;
+    }
+
+    // Splits the entropy-coded data at the restart markers, stopping at the EOI marker.
+    bool TrySplitScanData(
+        const uint8_t* data,
+        size_t size,
+        size_t scanDataOffset,
+        std::vector<std::vector<uint8_t>>* segments)
+    {
+        size_t segmentStart = scanDataOffset;
+        size_t offset = scanDataOffset;
+
+        while (offset + 1 < size)
+        {
+            if (data[offset] != MarkerPrefix)
+            {
+                offset++;
+                continue;
+            }
+
+            const uint8_t next = data[offset + 1];
+
+            if (next == 0)
+            {
+                // A stuffed 0xFF data byte.
+                offset += 2;
+            }
+            else if ((next >= FirstRestartMarker && next <= LastRestartMarker) || next == EndOfImageMarker)
+            {
+                segments->emplace_back(data + segmentStart, data + offset);
+
+                if (next == EndOfImageMarker)
+                {
+                    return true;
+                }
+
+                offset += 2;
+                segmentStart = offset;
+            }
+            else
+            {
+                return false;
+            }
+        }
+
+        return false;
+    }
+
+    class OutputWriter
+    {
+    public:
+        explicit OutputWriter(WriteCallback writeCallback)
+            : writeCallback(writeCallback), buffer(BufferSize), bufferLength(0), failed(false)
+        {
+        }
+
+        void Write(const uint8_t* data, size_t size)
+        {
+            if (failed)
+            {
+                return;
+            }
+
+            if (size > BufferSize - bufferLength)
+            {
+                Flush();
+
+                if (size >= BufferSize)
+                {
+                    failed = !writeCallback(data, size);
+                    return;
+                }
+            }
+
+            memcpy(buffer.data() + bufferLength, data, size);
+            bufferLength += size;
+        }
+
+        bool Flush()
+        {
+            if (!failed && bufferLength > 0)
+            {
+                failed = !writeCallback(buffer.data(), bufferLength);
+                bufferLength = 0;
+            }
+
+            return !failed;
+        }
+
+    private:
+        static constexpr size_t BufferSize = 65536;
+
+        WriteCallback writeCallback;
+        std::vector<uint8_t> buffer;
+        size_t bufferLength;
+        bool failed;
+    };
+
+    EncodeStatus WriteSplicedImage(const IncrementalEncoder* encoder, JpegLibraryErrorInfo* errorInfo, WriteCallback writeCallback)
+    {
+        OutputWriter writer(writeCallback);
+
+        writer.Write(encoder->header.data(), encoder->header.size());
+
+        const size_t bandCount = encoder->bands.size();
+
+        for (size_t i = 0; i < bandCount; i++)
+        {
+            const std::vector<uint8_t>& band = encoder->bands[i];
+
+            writer.Write(band.data(), band.size());
+
+            if (i + 1 < bandCount)
+            {
+                const uint8_t restartMarker[2] = { MarkerPrefix, static_cast<uint8_t>(FirstRestartMarker + (i % 8)) };
+
+                writer.Write(restartMarker, sizeof(restartMarker));
+            }
+        }
+
+        const uint8_t endOfImage[2] = { MarkerPrefix, EndOfImageMarker };
+
+        writer.Write(endOfImage, sizeof(endOfImage));
+
+        if (!writer.Flush())
+        {
+            strcpy_s(errorInfo->errorMessage, "File write error.");
+            return EncodeStatus::JpegLibraryError;
+        }
+
+        return EncodeStatus::Ok;
+    }
+
+    EncodeStatus EncodeFullImage(
+        IncrementalEncoder* encoder,
+        const BitmapData* bgraImage,
+        const EncodeOptions* options,
+        const MetadataParams* metadata,
+        const ContentHash& metadataHash,
+        JpegLibraryErrorInfo* errorInfo,
+        ProgressCallback progressCallback,
+        WriteCallback writeCallback)
+    {
+        encoder->valid = false;
+
+        MemoryDestinationHolder output;
+        uint32_t bandHeight = 0;
+
+        EncodeStatus status = EncodeToMemory(
+            bgraImage,
+            options->quality,
+            options->chromaSubsampling,
+            metadata,
+            &output.destination,
+            errorInfo,
+            progressCallback,
+            &bandHeight);
+
+        if (status != EncodeStatus::Ok)
+        {
+            return status;
+        }
+
+        if (!writeCallback(output.destination.data, output.destination.size))
+        {
+            strcpy_s(errorInfo->errorMessage, "File write error.");
+            return EncodeStatus::JpegLibraryError;
+        }
+
+        const uint8_t* data = output.destination.data;
+        const size_t size = output.destination.size;
+        size_t scanDataOffset = 0;
+
+        encoder->bands.clear();
+        encoder->bandHashes.clear();
+
+        if (!TryFindScanData(data, size, &scanDataOffset) ||
+            !TrySplitScanData(data, size, scanDataOffset, &encoder->bands))
+        {
+            return EncodeStatus::Ok;
+        }
+
+        const uint32_t bandCount = (bgraImage->height + bandHeight - 1) / bandHeight;
+
+        // libjpeg limits the restart interval to 65535 MCUs, a wider image would
+        // not have a restart marker at the end of every MCU row.
+        if (encoder->bands.size() != bandCount)
+        {
+            encoder->bands.clear();
+            return EncodeStatus::Ok;
+        }
+
+        encoder->header.assign(data, data + scanDataOffset);
+        encoder->bandHashes.reserve(bandCount);
+
+        for (uint32_t i = 0; i < bandCount; i++)
+        {
+            const uint32_t firstRow = i * bandHeight;
+            const uint32_t rowCount = std::min(bandHeight, bgraImage->height - firstRow);
+
+            encoder->bandHashes.push_back(HashBand(bgraImage, firstRow, rowCount));
+        }
+
+        encoder->width = bgraImage->width;
+        encoder->height = bgraImage->height;
+        encoder->quality = options->quality;
+        encoder->chromaSubsampling = options->chromaSubsampling;
+        encoder->metadataHash = metadataHash;
+        encoder->bandHeight = bandHeight;
+        encoder->valid = true;
+
+        return EncodeStatus::Ok;
+    }
+
+    EncodeStatus EncodeChangedBands(
+        IncrementalEncoder* encoder,
+        const BitmapData* bgraImage,
+        const EncodeOptions* options,
+        const MetadataParams* metadata,
+        const ContentHash& metadataHash,
+        JpegLibraryErrorInfo* errorInfo,
+        ProgressCallback progressCallback,
+        WriteCallback writeCallback)
+    {
+        const uint32_t bandHeight = encoder->bandHeight;
+        const uint32_t bandCount = static_cast<uint32_t>(encoder->bands.size());
+        int32_t currentProgressPercentage = -1;
+
+        for (uint32_t i = 0; i < bandCount; i++)
+        {
+            if (!ReportEncodeProgress(progressCallback, i, bandCount, &currentProgressPercentage))
+            {
+                return EncodeStatus::UserCanceled;
+            }
+
+            const uint32_t firstRow = i * bandHeight;
+            const uint32_t rowCount = std::min(bandHeight, bgraImage->height - firstRow);
+
+            const ContentHash bandHash = HashBand(bgraImage, firstRow, rowCount);
+
+            if (bandHash == encoder->bandHashes[i])
+            {
+                continue;
+            }
+
+            // Encoding the MCU row as a separate image produces the same entropy-coded data
+            // as the restart interval in the full image, because both start with reset DC predictors.
+            BitmapData band{};
+            band.scan0 = bgraImage->scan0 + (static_cast<size_t>(firstRow) * bgraImage->stride);
+            band.width = bgraImage->width;
+            band.height = rowCount;
+            band.stride = bgraImage->stride;
+
+            MemoryDestinationHolder bandOutput;
+
+            EncodeStatus status = EncodeToMemory(
+                &band,
+                options->quality,
+                options->chromaSubsampling,
+                nullptr,
+                &bandOutput.destination,
+                errorInfo,
+                nullptr,
+                nullptr);
+
+            if (status != EncodeStatus::Ok)
+            {
+                return status;
+            }
+
+            std::vector<std::vector<uint8_t>> segments;
+            size_t scanDataOffset = 0;
+
+            if (!TryFindScanData(bandOutput.destination.data, bandOutput.destination.size, &scanDataOffset) ||
+                !TrySplitScanData(bandOutput.destination.data, bandOutput.destination.size, scanDataOffset, &segments) ||
+                segments.size() != 1)
+            {
+                return EncodeFullImage(
+                    encoder,
+                    bgraImage,
+                    options,
+                    metadata,
+                    metadataHash,
+                    errorInfo,
+                    progressCallback,
+                    writeCallback);
+            }
+
+            encoder->bands[i] = std::move(segments[0]);
+            encoder->bandHashes[i] = bandHash;
+        }
+
+        return WriteSplicedImage(encoder, errorInfo, writeCallback);
+    }
+}
+
+EncodeStatus WriteIncrementalImage(
+    IncrementalEncoder* encoder,
+    const BitmapData* bgraImage,
+    const EncodeOptions* options,
+    const MetadataParams* metadata,
+    JpegLibraryErrorInfo* errorInfo,
+    ProgressCallback progressCallback,
+    WriteCallback writeCallback)
+{
+    try
+    {
+        const ContentHash metadataHash = HashMetadata(metadata);
+
+        const bool canReuseBands = encoder->valid &&
+            encoder->width == bgraImage->width &&
+            encoder->height == bgraImage->height &&
+            encoder->quality == options->quality &&
+            encoder->chromaSubsampling == options->chromaSubsampling &&
+            encoder->metadataHash == metadataHash;
+
+        if (canReuseBands)
+        {
+            return EncodeChangedBands(
+                encoder,
+                bgraImage,
+                options,
+                metadata,
+                metadataHash,
+                errorInfo,
+                progressCallback,
+                writeCallback);
+        }
+
+        return EncodeFullImage(
+            encoder,
+            bgraImage,
+            options,
+            metadata,
+            metadataHash,
+            errorInfo,
+            progressCallback,
+            writeCallback);
+    }
+    catch (const std::bad_alloc&)
+    {
+        encoder->valid = false;
+
+        return EncodeStatus::OutOfMemory;
+    }
+}
+
+IncrementalEncoder* CreateIncrementalEncoder()
+{
+    return new (std::nothrow) IncrementalEncoder();
+}
+
+void DestroyIncrementalEncoder(IncrementalEncoder* encoder)
+{
+    delete encoder;
+}
+
+EncodeStatus WriteImageIncremental(
+    IncrementalEncoder* encoder,
+    const BitmapData* bgraImage,
+    const EncodeOptions* options,
+    const MetadataParams* metadata,
+    JpegLibraryErrorInfo* errorInfo,
+    ProgressCallback progressCallback,
+    WriteCallback writeCallback)
+{
+    if (encoder == nullptr || bgraImage == nullptr || options == nullptr || errorInfo == nullptr || writeCallback == nullptr)
+    {
+        return EncodeStatus::NullParameter;
+    }
+
+    return WriteIncrementalImage(encoder, bgraImage, options, metadata, errorInfo, progressCallback, writeCallback);
+}
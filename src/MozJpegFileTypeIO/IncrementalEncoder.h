@@ -0,0 +1,24 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-mozjpeg, a FileType plugin for Paint.NET
+// that saves JPEG images using the mozjpeg encoder.
+//
+// Copyright (c) 2021, 2022 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MozJpegFileTypeIO.h"
+
+EncodeStatus WriteIncrementalImage(
+    IncrementalEncoder* encoder,
+    const BitmapData* bgraImage,
+    const EncodeOptions* options,
+    const MetadataParams* metadata,
+    JpegLibraryErrorInfo* errorInfo,
+    ProgressCallback progressCallback,
+    WriteCallback writeCallback);
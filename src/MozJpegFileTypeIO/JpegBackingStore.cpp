@@ -0,0 +1,88 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-mozjpeg, a FileType plugin for Paint.NET
+// that saves JPEG images using the mozjpeg encoder.
+//
+// Copyright (c) 2021, 2022 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "JpegBackingStore.h"
+
+namespace
+{
+    void SeekBackingStore(j_common_ptr cinfo, JpegBackingStore* backingStore, uint64_t offset)
+    {
+#ifdef _MSC_VER
+        const int result = _fseeki64(backingStore->file, static_cast<__int64>(offset), SEEK_SET);
+#else
+        const int result = fseeko(backingStore->file, static_cast<off_t>(offset), SEEK_SET);
+#endif
+
+        if (result != 0)
+        {
+            ERREXIT(cinfo, JERR_TFILE_SEEK);
+        }
+    }
+}
+
+void OpenBackingStore(j_common_ptr cinfo, JpegBackingStore* backingStore)
+{
+    // The temporary file is created in the user's temporary directory and it is
+    // removed when it is closed, or when the process exits.
+#ifdef _MSC_VER
+    if (tmpfile_s(&backingStore->file) != 0)
+    {
+        backingStore->file = nullptr;
+    }
+#else
+    backingStore->file = tmpfile();
+#endif
+
+    if (backingStore->file == nullptr)
+    {
+        ERREXITS(cinfo, JERR_TFILE_CREATE, "");
+    }
+}
+
+void ReadBackingStore(
+    j_common_ptr cinfo,
+    JpegBackingStore* backingStore,
+    void* buffer,
+    uint64_t offset,
+    size_t size)
+{
+    SeekBackingStore(cinfo, backingStore, offset);
+
+    if (fread(buffer, 1, size, backingStore->file) != size)
+    {
+        ERREXIT(cinfo, JERR_TFILE_READ);
+    }
+}
+
+void WriteBackingStore(
+    j_common_ptr cinfo,
+    JpegBackingStore* backingStore,
+    const void* buffer,
+    uint64_t offset,
+    size_t size)
+{
+    SeekBackingStore(cinfo, backingStore, offset);
+
+    if (fwrite(buffer, 1, size, backingStore->file) != size)
+    {
+        ERREXIT(cinfo, JERR_TFILE_WRITE);
+    }
+}
+
+void CloseBackingStore(JpegBackingStore* backingStore)
+{
+    if (backingStore->file != nullptr)
+    {
+        fclose(backingStore->file);
+        backingStore->file = nullptr;
+    }
+}
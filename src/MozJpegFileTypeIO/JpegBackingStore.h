@@ -0,0 +1,44 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-mozjpeg, a FileType plugin for Paint.NET
+// that saves JPEG images using the mozjpeg encoder.
+//
+// Copyright (c) 2021, 2022 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <jpeglib.h>
+#include <jerror.h>
+
+// A temporary file that holds the parts of a virtual block array that do not fit in memory.
+// The file is deleted when it is closed.
+struct JpegBackingStore
+{
+    FILE* file;
+};
+
+void OpenBackingStore(j_common_ptr cinfo, JpegBackingStore* backingStore);
+
+void ReadBackingStore(
+    j_common_ptr cinfo,
+    JpegBackingStore* backingStore,
+    void* buffer,
+    uint64_t offset,
+    size_t size);
+
+void WriteBackingStore(
+    j_common_ptr cinfo,
+    JpegBackingStore* backingStore,
+    const void* buffer,
+    uint64_t offset,
+    size_t size);
+
+// It is safe to call this method on a backing store that was not opened, or that was already closed.
+void CloseBackingStore(JpegBackingStore* backingStore);
@@ -22,6 +22,7 @@ namespace
         jpeg_destination_mgr mgr;
 
         WriteCallback write;
+        uint64_t bytesWritten;
         JOCTET buffer[WriteContextBufferSize];
     };
 
@@ -31,6 +32,7 @@ namespace
 
         ctx->mgr.next_output_byte = ctx->buffer;
         ctx->mgr.free_in_buffer = WriteContextBufferSize;
+        ctx->bytesWritten = 0;
     }
 
     boolean empty_output_buffer(j_compress_ptr cinfo)
@@ -42,6 +44,7 @@ namespace
             ERREXIT(cinfo, JERR_FILE_WRITE);
         }
 
+        ctx->bytesWritten += WriteContextBufferSize;
         ctx->mgr.next_output_byte = ctx->buffer;
         ctx->mgr.free_in_buffer = WriteContextBufferSize;
 
@@ -59,6 +62,8 @@ namespace
             {
                 ERREXIT(cinfo, JERR_FILE_WRITE);
             }
+
+            ctx->bytesWritten += remaining;
         }
     }
 }
@@ -86,3 +91,10 @@ void InitializeDestinationManager(j_compress_ptr cinfo, WriteCallback writeCallb
     ctx->mgr.term_destination = term_destination;
     ctx->write = writeCallback;
 }
+
+uint64_t GetBytesWritten(j_compress_ptr cinfo)
+{
+    const JpegWriteContext* ctx = reinterpret_cast<const JpegWriteContext*>(cinfo->dest);
+
+    return ctx->bytesWritten;
+}
@@ -18,3 +18,6 @@
 #include <jerror.h>
 
 void InitializeDestinationManager(j_compress_ptr cinfo, WriteCallback writeCallback);
+
+// Gets the number of bytes that were passed to the write callback since jpeg_start_compress was called.
+uint64_t GetBytesWritten(j_compress_ptr cinfo);
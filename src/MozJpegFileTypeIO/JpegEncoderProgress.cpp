@@ -0,0 +1,60 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-mozjpeg, a FileType plugin for Paint.NET
+// that saves JPEG images using the mozjpeg encoder.
+//
+// Copyright (c) 2021, 2022 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "JpegEncoderProgress.h"
+#include <math.h>
+
+bool ReportEncodeProgress(
+    ProgressCallback callback,
+    uint64_t completed,
+    uint64_t total,
+    int32_t* currentProgressPercentage)
+{
+    if (callback == nullptr || total == 0)
+    {
+        return true;
+    }
+
+    double progressPercentage = (static_cast<double>(completed) / static_cast<double>(total)) * 100.0;
+    int32_t roundedPercentage = static_cast<int32_t>(round(progressPercentage));
+
+    if (*currentProgressPercentage == roundedPercentage)
+    {
+        return true;
+    }
+
+    *currentProgressPercentage = roundedPercentage;
+
+    return callback(roundedPercentage);
+}
+
+bool WriteScanlines(
+    j_compress_ptr cinfo,
+    const BitmapData* image,
+    ProgressCallback progressCallback)
+{
+    int32_t currentProgressPercentage = -1;
+
+    while (cinfo->next_scanline < cinfo->image_height)
+    {
+        if (!ReportEncodeProgress(progressCallback, cinfo->next_scanline, cinfo->image_height, &currentProgressPercentage))
+        {
+            return false;
+        }
+
+        uint8_t* srcRow = image->scan0 + (static_cast<size_t>(cinfo->next_scanline) * image->stride);
+
+        jpeg_write_scanlines(cinfo, &srcRow, 1);
+    }
+
+    return true;
+}
@@ -0,0 +1,33 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-mozjpeg, a FileType plugin for Paint.NET
+// that saves JPEG images using the mozjpeg encoder.
+//
+// Copyright (c) 2021, 2022 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MozJpegFileTypeIO.h"
+#include <stdio.h>
+#include <jpeglib.h>
+#include <jerror.h>
+
+// Calls the progress callback when the rounded percentage of the completed work has changed.
+// Returns false if the user canceled the operation.
+bool ReportEncodeProgress(
+    ProgressCallback callback,
+    uint64_t completed,
+    uint64_t total,
+    int32_t* currentProgressPercentage);
+
+// Writes the rows of the image that have not been written yet and reports the progress.
+// Returns false if the user canceled the encode, the caller must destroy the compressor.
+bool WriteScanlines(
+    j_compress_ptr cinfo,
+    const BitmapData* image,
+    ProgressCallback progressCallback);
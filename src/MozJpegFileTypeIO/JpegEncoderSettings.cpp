@@ -0,0 +1,105 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-mozjpeg, a FileType plugin for Paint.NET
+// that saves JPEG images using the mozjpeg encoder.
+//
+// Copyright (c) 2021, 2022 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "JpegEncoderSettings.h"
+
+namespace
+{
+    // The base quantization table set that jpeg_set_defaults selects for JCP_MAX_COMPRESSION.
+    constexpr int MaxCompressionBaseQuantTableIndex = 3;
+}
+
+void SetEncoderSettings(
+    j_compress_ptr cinfo,
+    const BitmapData* image,
+    int quality,
+    ChromaSubsampling chromaSubsampling,
+    bool progressive,
+    bool singlePass)
+{
+    const bool isGrayscale = chromaSubsampling == ChromaSubsampling::Subsampling400;
+
+    cinfo->image_width = image->width;
+    cinfo->image_height = image->height;
+    cinfo->input_components = isGrayscale ? 1 : 3;
+#pragma warning(suppress: 26812) // Suppress C26812: Prefer 'enum class' over 'enum'.
+    cinfo->in_color_space = JCS_EXT_BGRX;
+
+    if (singlePass)
+    {
+        // The fastest profile disables trellis quantization and scan optimization, which both
+        // need the whole image. This must be set before jpeg_set_defaults is called.
+        jpeg_c_set_int_param(cinfo, JINT_COMPRESS_PROFILE, JCP_FASTEST);
+
+        // A progressive image always buffers the coefficients for the whole image.
+        progressive = false;
+    }
+
+    jpeg_set_defaults(cinfo);
+
+    if (singlePass)
+    {
+        // jpeg_set_defaults also selects the base quantization tables from the profile, the fastest
+        // profile uses the Annex K tables while the default max compression profile uses table set 3.
+        // The table set is restored so that a quality value produces the same quantization in every mode.
+        jpeg_c_set_int_param(cinfo, JINT_BASE_QUANT_TBL_IDX, MaxCompressionBaseQuantTableIndex);
+    }
+
+    jpeg_set_colorspace(cinfo, isGrayscale ? JCS_GRAYSCALE : JCS_YCbCr);
+
+    jpeg_set_quality(cinfo, quality, !progressive);
+    // Without optimized coding jpeg_set_defaults leaves the standard Huffman tables
+    // from Annex K of the JPEG specification in place.
+    cinfo->optimize_coding = !singlePass;
+
+    if (progressive)
+    {
+        jpeg_simple_progression(cinfo);
+    }
+
+    if (isGrayscale)
+    {
+        cinfo->comp_info[0].h_samp_factor = 1;
+        cinfo->comp_info[0].v_samp_factor = 1;
+    }
+    else
+    {
+        switch (chromaSubsampling)
+        {
+
+        case ChromaSubsampling::Subsampling420:
+            cinfo->comp_info[0].h_samp_factor = 2;
+            cinfo->comp_info[0].v_samp_factor = 2;
+            cinfo->comp_info[1].h_samp_factor = 1;
+            cinfo->comp_info[1].v_samp_factor = 1;
+            cinfo->comp_info[2].h_samp_factor = 1;
+            cinfo->comp_info[2].v_samp_factor = 1;
+            break;
+        case ChromaSubsampling::Subsampling422:
+            cinfo->comp_info[0].h_samp_factor = 2;
+            cinfo->comp_info[0].v_samp_factor = 1;
+            cinfo->comp_info[1].h_samp_factor = 1;
+            cinfo->comp_info[1].v_samp_factor = 1;
+            cinfo->comp_info[2].h_samp_factor = 1;
+            cinfo->comp_info[2].v_samp_factor = 1;
+            break;
+        case ChromaSubsampling::Subsampling444:
+            cinfo->comp_info[0].h_samp_factor = 1;
+            cinfo->comp_info[0].v_samp_factor = 1;
+            cinfo->comp_info[1].h_samp_factor = 1;
+            cinfo->comp_info[1].v_samp_factor = 1;
+            cinfo->comp_info[2].h_samp_factor = 1;
+            cinfo->comp_info[2].v_samp_factor = 1;
+            break;
+        }
+    }
+}
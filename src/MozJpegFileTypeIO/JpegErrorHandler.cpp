@@ -0,0 +1,44 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-mozjpeg, a FileType plugin for Paint.NET
+// that saves JPEG images using the mozjpeg encoder.
+//
+// Copyright (c) 2021, 2022 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "JpegErrorHandler.h"
+#include <string.h>
+
+void error_exit(j_common_ptr cinfo)
+{
+    JpegErrorContext* ctx = reinterpret_cast<JpegErrorContext*>(cinfo->err);
+
+    switch (ctx->mgr.msg_code)
+    {
+    case JERR_FILE_READ:
+        strcpy_s(ctx->messageBuffer, "File read error.");
+        break;
+    case JERR_FILE_WRITE:
+        strcpy_s(ctx->messageBuffer, "File write error.");
+        break;
+    default:
+        ctx->mgr.format_message(reinterpret_cast<j_common_ptr>(cinfo), ctx->messageBuffer);
+        break;
+    }
+
+    longjmp(ctx->setjmpBuffer, 1);
+}
+
+void HandleErrorMessage(const JpegErrorContext& ctx, JpegLibraryErrorInfo* info)
+{
+    const size_t errorMessageLength = strlen(ctx.messageBuffer);
+
+    if (errorMessageLength > 0 && errorMessageLength <= JpegLibraryErrorInfo::maxErrorMessageLength)
+    {
+        strncpy_s(info->errorMessage, ctx.messageBuffer, errorMessageLength);
+    }
+}
@@ -0,0 +1,31 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-mozjpeg, a FileType plugin for Paint.NET
+// that saves JPEG images using the mozjpeg encoder.
+//
+// Copyright (c) 2021, 2022 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MozJpegFileTypeIO.h"
+#include <stdio.h>
+#include <jpeglib.h>
+#include <jerror.h>
+#include <setjmp.h>
+
+struct JpegErrorContext
+{
+    jpeg_error_mgr mgr;
+
+    char messageBuffer[JMSG_LENGTH_MAX];
+    jmp_buf setjmpBuffer;
+};
+
+void error_exit(j_common_ptr cinfo);
+
+void HandleErrorMessage(const JpegErrorContext& ctx, JpegLibraryErrorInfo* info);
@@ -0,0 +1,129 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-mozjpeg, a FileType plugin for Paint.NET
+// that saves JPEG images using the mozjpeg encoder.
+//
+// Copyright (c) 2021, 2022 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "JpegMemoryDestinationManager.h"
+#include <stdlib.h>
+#include <string.h>
+
+namespace
+{
+    constexpr size_t MemoryWriteContextBufferSize = 4096;
+
+    struct JpegMemoryWriteContext
+    {
+        jpeg_destination_mgr mgr;
+
+        MemoryDestination* destination;
+        JOCTET buffer[MemoryWriteContextBufferSize];
+    };
+
+    void AppendToDestination(j_compress_ptr cinfo, const JOCTET* data, size_t dataSize)
+    {
+        JpegMemoryWriteContext* ctx = reinterpret_cast<JpegMemoryWriteContext*>(cinfo->dest);
+        MemoryDestination* destination = ctx->destination;
+
+        const size_t newSize = destination->size + dataSize;
+
+        if (destination->sizeLimit != nullptr && newSize > destination->sizeLimit->load(std::memory_order_relaxed))
+        {
+            destination->sizeLimitExceeded = true;
+            ERREXIT(cinfo, JERR_FILE_WRITE);
+        }
+
+        if (newSize > destination->capacity)
+        {
+            size_t newCapacity = destination->capacity > 0 ? destination->capacity * 2 : MemoryWriteContextBufferSize * 16;
+
+            while (newCapacity < newSize)
+            {
+                newCapacity *= 2;
+            }
+
+            uint8_t* newData = static_cast<uint8_t*>(realloc(destination->data, newCapacity));
+
+            if (newData == nullptr)
+            {
+                ERREXIT1(cinfo, JERR_OUT_OF_MEMORY, 0);
+            }
+
+            destination->data = newData;
+            destination->capacity = newCapacity;
+        }
+
+        memcpy(destination->data + destination->size, data, dataSize);
+        destination->size = newSize;
+    }
+
+    void init_destination(j_compress_ptr cinfo)
+    {
+        JpegMemoryWriteContext* ctx = reinterpret_cast<JpegMemoryWriteContext*>(cinfo->dest);
+
+        ctx->mgr.next_output_byte = ctx->buffer;
+        ctx->mgr.free_in_buffer = MemoryWriteContextBufferSize;
+    }
+
+    boolean empty_output_buffer(j_compress_ptr cinfo)
+    {
+        JpegMemoryWriteContext* ctx = reinterpret_cast<JpegMemoryWriteContext*>(cinfo->dest);
+
+        AppendToDestination(cinfo, ctx->buffer, MemoryWriteContextBufferSize);
+
+        ctx->mgr.next_output_byte = ctx->buffer;
+        ctx->mgr.free_in_buffer = MemoryWriteContextBufferSize;
+
+        return true;
+    }
+
+    void term_destination(j_compress_ptr cinfo)
+    {
+        JpegMemoryWriteContext* ctx = reinterpret_cast<JpegMemoryWriteContext*>(cinfo->dest);
+        size_t remaining = MemoryWriteContextBufferSize - ctx->mgr.free_in_buffer;
+
+        if (remaining > 0)
+        {
+            AppendToDestination(cinfo, ctx->buffer, remaining);
+        }
+    }
+}
+
+void InitializeMemoryDestinationManager(j_compress_ptr cinfo, MemoryDestination* destination)
+{
+    if (cinfo->dest == nullptr)
+    {
+        cinfo->dest = static_cast<jpeg_destination_mgr*>((*cinfo->mem->alloc_small)(
+            reinterpret_cast<j_common_ptr>(cinfo),
+            JPOOL_PERMANENT,
+            sizeof(JpegMemoryWriteContext)));
+    }
+    else if (cinfo->dest->init_destination != init_destination)
+    {
+        // The destination manager was not created by this function.
+
+        ERREXIT(cinfo, JERR_BUFFER_SIZE);
+    }
+
+    JpegMemoryWriteContext* ctx = reinterpret_cast<JpegMemoryWriteContext*>(cinfo->dest);
+
+    ctx->mgr.init_destination = init_destination;
+    ctx->mgr.empty_output_buffer = empty_output_buffer;
+    ctx->mgr.term_destination = term_destination;
+    ctx->destination = destination;
+}
+
+void FreeMemoryDestination(MemoryDestination* destination)
+{
+    free(destination->data);
+
+    destination->data = nullptr;
+    destination->size = 0;
+    destination->capacity = 0;
+}
@@ -0,0 +1,35 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-mozjpeg, a FileType plugin for Paint.NET
+// that saves JPEG images using the mozjpeg encoder.
+//
+// Copyright (c) 2021, 2022 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MozJpegFileTypeIO.h"
+#include <atomic>
+#include <stdio.h>
+#include <jpeglib.h>
+#include <jerror.h>
+
+struct MemoryDestination
+{
+    uint8_t* data;
+    size_t size;
+    size_t capacity;
+    // Optional, the encoder is stopped when the output grows larger than this value.
+    // With optimized Huffman tables the output is only written by jpeg_finish_compress,
+    // so this limits the memory used by the output but not the compression work.
+    const std::atomic<size_t>* sizeLimit;
+    bool sizeLimitExceeded;
+};
+
+void InitializeMemoryDestinationManager(j_compress_ptr cinfo, MemoryDestination* destination);
+
+void FreeMemoryDestination(MemoryDestination* destination);
@@ -0,0 +1,451 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-mozjpeg, a FileType plugin for Paint.NET
+// that saves JPEG images using the mozjpeg encoder.
+//
+// Copyright (c) 2021, 2022 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "JpegMemoryTracker.h"
+#include "JpegBackingStore.h"
+#include <algorithm>
+#include <limits>
+#include <string.h>
+
+// A port of the virtual block array from jmemmgr.c that keeps rowsInMem rows in memory,
+// and moves the other rows to and from a temporary file when they are accessed.
+struct SpillableBlockArray
+{
+    JBLOCKARRAY memBuffer;
+    JDIMENSION rowsInArray;
+    JDIMENSION blocksPerRow;
+    JDIMENSION maxAccess;
+    JDIMENSION rowsInMem;
+    // The first row of the array that is in memBuffer.
+    JDIMENSION curStartRow;
+    // The rows from this index on have not been written.
+    JDIMENSION firstUndefRow;
+    bool preZero;
+    // The rows in memBuffer have been changed since they were read from the temporary file.
+    bool dirty;
+    // The number of bytes that have been written to the temporary file.
+    uint64_t backingStoreSize;
+    JpegBackingStore backingStore;
+    SpillableBlockArray* next;
+};
+
+namespace
+{
+    JpegMemoryTracker* GetTracker(j_common_ptr cinfo)
+    {
+        return static_cast<JpegMemoryTracker*>(cinfo->client_data);
+    }
+
+    void AddAllocation(j_common_ptr cinfo, int poolId, uint64_t size)
+    {
+        JpegMemoryTracker* tracker = GetTracker(cinfo);
+
+        const uint64_t currentBytes = tracker->poolBytes[JPOOL_PERMANENT] + tracker->poolBytes[JPOOL_IMAGE];
+
+        if (tracker->limit != 0 && size > tracker->limit - std::min(currentBytes, tracker->limit))
+        {
+            ERREXIT1(cinfo, JERR_OUT_OF_MEMORY, 0);
+        }
+
+        tracker->poolBytes[poolId] += size;
+        tracker->peakBytes = std::max(tracker->peakBytes, currentBytes + size);
+    }
+
+    void* alloc_small(j_common_ptr cinfo, int pool_id, size_t sizeofobject)
+    {
+        AddAllocation(cinfo, pool_id, sizeofobject);
+
+        return GetTracker(cinfo)->original.alloc_small(cinfo, pool_id, sizeofobject);
+    }
+
+    void* alloc_large(j_common_ptr cinfo, int pool_id, size_t sizeofobject)
+    {
+        AddAllocation(cinfo, pool_id, sizeofobject);
+
+        return GetTracker(cinfo)->original.alloc_large(cinfo, pool_id, sizeofobject);
+    }
+
+    JSAMPARRAY alloc_sarray(j_common_ptr cinfo, int pool_id, JDIMENSION samplesperrow, JDIMENSION numrows)
+    {
+        AddAllocation(
+            cinfo,
+            pool_id,
+            static_cast<uint64_t>(numrows) * (sizeof(JSAMPROW) + (static_cast<uint64_t>(samplesperrow) * sizeof(JSAMPLE))));
+
+        return GetTracker(cinfo)->original.alloc_sarray(cinfo, pool_id, samplesperrow, numrows);
+    }
+
+    JBLOCKARRAY alloc_barray(j_common_ptr cinfo, int pool_id, JDIMENSION blocksperrow, JDIMENSION numrows)
+    {
+        AddAllocation(
+            cinfo,
+            pool_id,
+            static_cast<uint64_t>(numrows) * (sizeof(JBLOCKROW) + (static_cast<uint64_t>(blocksperrow) * sizeof(JBLOCK))));
+
+        return GetTracker(cinfo)->original.alloc_barray(cinfo, pool_id, blocksperrow, numrows);
+    }
+
+    jvirt_sarray_ptr request_virt_sarray(
+        j_common_ptr cinfo,
+        int pool_id,
+        boolean pre_zero,
+        JDIMENSION samplesperrow,
+        JDIMENSION numrows,
+        JDIMENSION maxaccess)
+    {
+        GetTracker(cinfo)->pendingVirtualArrayBytes += static_cast<uint64_t>(numrows) * samplesperrow * sizeof(JSAMPLE);
+
+        return GetTracker(cinfo)->original.request_virt_sarray(cinfo, pool_id, pre_zero, samplesperrow, numrows, maxaccess);
+    }
+
+    jvirt_barray_ptr request_virt_barray(
+        j_common_ptr cinfo,
+        int pool_id,
+        boolean pre_zero,
+        JDIMENSION blocksperrow,
+        JDIMENSION numrows,
+        JDIMENSION maxaccess)
+    {
+        GetTracker(cinfo)->pendingVirtualArrayBytes += static_cast<uint64_t>(numrows) * blocksperrow * sizeof(JBLOCK);
+
+        return GetTracker(cinfo)->original.request_virt_barray(cinfo, pool_id, pre_zero, blocksperrow, numrows, maxaccess);
+    }
+
+    jvirt_barray_ptr request_spillable_barray(
+        j_common_ptr cinfo,
+        int pool_id,
+        boolean pre_zero,
+        JDIMENSION blocksperrow,
+        JDIMENSION numrows,
+        JDIMENSION maxaccess)
+    {
+        JpegMemoryTracker* tracker = GetTracker(cinfo);
+
+        // Only image lifetime virtual arrays are supported.
+        if (pool_id != JPOOL_IMAGE)
+        {
+            ERREXIT1(cinfo, JERR_BAD_POOL_ID, pool_id);
+        }
+
+        SpillableBlockArray* array = static_cast<SpillableBlockArray*>(
+            (*cinfo->mem->alloc_small)(cinfo, pool_id, sizeof(SpillableBlockArray)));
+
+        array->memBuffer = nullptr;
+        array->rowsInArray = numrows;
+        array->blocksPerRow = blocksperrow;
+        array->maxAccess = maxaccess;
+        array->rowsInMem = 0;
+        array->curStartRow = 0;
+        array->firstUndefRow = 0;
+        array->preZero = pre_zero != 0;
+        array->dirty = false;
+        array->backingStoreSize = 0;
+        array->backingStore.file = nullptr;
+        array->next = tracker->blockArrays;
+        tracker->blockArrays = array;
+
+        // libjpeg only passes the array handle back to the access_virt_barray method,
+        // which is replaced by access_spillable_barray.
+        return reinterpret_cast<jvirt_barray_ptr>(array);
+    }
+
+    uint64_t GetBlockArrayRowBytes(const SpillableBlockArray* array)
+    {
+        // This matches the size that alloc_barray counts for each row.
+        return sizeof(JBLOCKROW) + (static_cast<uint64_t>(array->blocksPerRow) * sizeof(JBLOCK));
+    }
+
+    void RealizeSpillableBlockArrays(j_common_ptr cinfo, JpegMemoryTracker* tracker)
+    {
+        uint64_t spacePerMinHeight = 0;
+        uint64_t maximumSpace = 0;
+
+        for (SpillableBlockArray* array = tracker->blockArrays; array != nullptr; array = array->next)
+        {
+            if (array->memBuffer == nullptr)
+            {
+                const uint64_t rowBytes = GetBlockArrayRowBytes(array);
+
+                spacePerMinHeight += rowBytes * array->maxAccess;
+                maximumSpace += rowBytes * array->rowsInArray;
+            }
+        }
+
+        if (spacePerMinHeight == 0)
+        {
+            return;
+        }
+
+        const uint64_t currentBytes = tracker->poolBytes[JPOOL_PERMANENT] + tracker->poolBytes[JPOOL_IMAGE];
+        const uint64_t availableBytes = tracker->limit - std::min(currentBytes, tracker->limit);
+
+        // Each array keeps a multiple of maxAccess rows in memory, the same share of the
+        // available memory is used for every array.
+        uint64_t maxMinHeights;
+
+        if (availableBytes >= maximumSpace)
+        {
+            maxMinHeights = std::numeric_limits<uint64_t>::max();
+        }
+        else
+        {
+            maxMinHeights = std::max(availableBytes / spacePerMinHeight, static_cast<uint64_t>(1));
+        }
+
+        for (SpillableBlockArray* array = tracker->blockArrays; array != nullptr; array = array->next)
+        {
+            if (array->memBuffer == nullptr)
+            {
+                const uint64_t minHeights = ((static_cast<uint64_t>(array->rowsInArray) - 1) / array->maxAccess) + 1;
+
+                if (minHeights <= maxMinHeights)
+                {
+                    array->rowsInMem = array->rowsInArray;
+                }
+                else
+                {
+                    array->rowsInMem = static_cast<JDIMENSION>(std::min(
+                        maxMinHeights * array->maxAccess,
+                        static_cast<uint64_t>(array->rowsInArray)));
+
+                    OpenBackingStore(cinfo, &array->backingStore);
+                }
+
+                // The allocation is counted against the limit, so the decode fails with JERR_OUT_OF_MEMORY
+                // when the limit cannot hold maxAccess rows of every array.
+                array->memBuffer = (*cinfo->mem->alloc_barray)(cinfo, JPOOL_IMAGE, array->blocksPerRow, array->rowsInMem);
+                array->curStartRow = 0;
+                array->firstUndefRow = 0;
+                array->dirty = false;
+            }
+        }
+    }
+
+    void TransferBlockArrayRows(j_common_ptr cinfo, JpegMemoryTracker* tracker, SpillableBlockArray* array, bool writing)
+    {
+        const size_t rowBytes = static_cast<size_t>(array->blocksPerRow) * sizeof(JBLOCK);
+        const JDIMENSION endRow = std::min(
+            std::min(array->firstUndefRow, array->rowsInArray),
+            array->curStartRow + array->rowsInMem);
+
+        for (JDIMENSION row = array->curStartRow; row < endRow; row++)
+        {
+            JBLOCKROW buffer = array->memBuffer[row - array->curStartRow];
+            const uint64_t offset = static_cast<uint64_t>(row) * rowBytes;
+
+            if (writing)
+            {
+                WriteBackingStore(cinfo, &array->backingStore, buffer, offset, rowBytes);
+
+                if (offset + rowBytes > array->backingStoreSize)
+                {
+                    tracker->backingStoreBytes += (offset + rowBytes) - array->backingStoreSize;
+                    array->backingStoreSize = offset + rowBytes;
+                }
+            }
+            else if (offset < array->backingStoreSize)
+            {
+                ReadBackingStore(cinfo, &array->backingStore, buffer, offset, rowBytes);
+            }
+            else
+            {
+                // The row was zeroed by a read access, but it was never written to the temporary file.
+                memset(buffer, 0, rowBytes);
+            }
+        }
+    }
+
+    JBLOCKARRAY access_spillable_barray(
+        j_common_ptr cinfo,
+        jvirt_barray_ptr ptr,
+        JDIMENSION start_row,
+        JDIMENSION num_rows,
+        boolean writable)
+    {
+        JpegMemoryTracker* tracker = GetTracker(cinfo);
+        SpillableBlockArray* array = reinterpret_cast<SpillableBlockArray*>(ptr);
+
+        const JDIMENSION endRow = start_row + num_rows;
+
+        if (endRow > array->rowsInArray || num_rows > array->maxAccess || array->memBuffer == nullptr)
+        {
+            ERREXIT(cinfo, JERR_BAD_VIRTUAL_ACCESS);
+        }
+
+        if (start_row < array->curStartRow || endRow > array->curStartRow + array->rowsInMem)
+        {
+            if (array->backingStore.file == nullptr)
+            {
+                ERREXIT(cinfo, JERR_VIRTUAL_BUG);
+            }
+
+            if (array->dirty)
+            {
+                TransferBlockArrayRows(cinfo, tracker, array, true);
+                array->dirty = false;
+            }
+
+            // Move the window forward so that the requested rows are at the start,
+            // or backward so that they are at the end.
+            if (start_row > array->curStartRow)
+            {
+                array->curStartRow = start_row;
+            }
+            else
+            {
+                array->curStartRow = endRow > array->rowsInMem ? endRow - array->rowsInMem : 0;
+            }
+
+            TransferBlockArrayRows(cinfo, tracker, array, false);
+        }
+
+        if (array->firstUndefRow < endRow)
+        {
+            JDIMENSION undefRow;
+
+            if (array->firstUndefRow < start_row)
+            {
+                if (writable)
+                {
+                    ERREXIT(cinfo, JERR_BAD_VIRTUAL_ACCESS);
+                }
+
+                undefRow = start_row;
+            }
+            else
+            {
+                undefRow = array->firstUndefRow;
+            }
+
+            if (writable)
+            {
+                array->firstUndefRow = endRow;
+            }
+
+            if (array->preZero)
+            {
+                const size_t rowBytes = static_cast<size_t>(array->blocksPerRow) * sizeof(JBLOCK);
+
+                for (JDIMENSION row = undefRow; row < endRow; row++)
+                {
+                    memset(array->memBuffer[row - array->curStartRow], 0, rowBytes);
+                }
+            }
+            else if (!writable)
+            {
+                ERREXIT(cinfo, JERR_BAD_VIRTUAL_ACCESS);
+            }
+        }
+
+        if (writable)
+        {
+            array->dirty = true;
+        }
+
+        return array->memBuffer + (start_row - array->curStartRow);
+    }
+
+    void CloseSpillableBlockArrays(JpegMemoryTracker* tracker)
+    {
+        // The array structures and buffers are in the image pool, only the temporary files must be closed.
+        for (SpillableBlockArray* array = tracker->blockArrays; array != nullptr; array = array->next)
+        {
+            CloseBackingStore(&array->backingStore);
+        }
+
+        tracker->blockArrays = nullptr;
+    }
+
+    void realize_virt_arrays(j_common_ptr cinfo)
+    {
+        JpegMemoryTracker* tracker = GetTracker(cinfo);
+
+        // The virtual arrays that libjpeg manages are counted at their full size after they have
+        // been allocated, the memory manager keeps all of them in memory.
+        tracker->original.realize_virt_arrays(cinfo);
+
+        const uint64_t virtualArrayBytes = tracker->pendingVirtualArrayBytes;
+        tracker->pendingVirtualArrayBytes = 0;
+
+        tracker->poolBytes[JPOOL_IMAGE] += virtualArrayBytes;
+        tracker->peakBytes = std::max(
+            tracker->peakBytes,
+            tracker->poolBytes[JPOOL_PERMANENT] + tracker->poolBytes[JPOOL_IMAGE]);
+
+        RealizeSpillableBlockArrays(cinfo, tracker);
+    }
+
+    void free_pool(j_common_ptr cinfo, int pool_id)
+    {
+        JpegMemoryTracker* tracker = GetTracker(cinfo);
+
+        if (pool_id == JPOOL_IMAGE)
+        {
+            CloseSpillableBlockArrays(tracker);
+        }
+
+        tracker->original.free_pool(cinfo, pool_id);
+
+        tracker->poolBytes[pool_id] = 0;
+
+        if (pool_id == JPOOL_IMAGE)
+        {
+            tracker->pendingVirtualArrayBytes = 0;
+        }
+    }
+
+    void self_destruct(j_common_ptr cinfo)
+    {
+        JpegMemoryTracker* tracker = GetTracker(cinfo);
+
+        // The libjpeg self_destruct method frees the pools without calling the free_pool method.
+        CloseSpillableBlockArrays(tracker);
+
+        tracker->original.self_destruct(cinfo);
+    }
+}
+
+void InitializeMemoryTracker(j_common_ptr cinfo, JpegMemoryTracker* tracker, uint64_t limit)
+{
+    tracker->original = *cinfo->mem;
+    tracker->limit = limit;
+    tracker->peakBytes = 0;
+    tracker->pendingVirtualArrayBytes = 0;
+    tracker->blockArrays = nullptr;
+    tracker->backingStoreBytes = 0;
+
+    for (int i = 0; i < JPOOL_NUMPOOLS; i++)
+    {
+        tracker->poolBytes[i] = 0;
+    }
+
+    cinfo->client_data = tracker;
+
+    cinfo->mem->alloc_small = alloc_small;
+    cinfo->mem->alloc_large = alloc_large;
+    cinfo->mem->alloc_sarray = alloc_sarray;
+    cinfo->mem->alloc_barray = alloc_barray;
+    cinfo->mem->request_virt_sarray = request_virt_sarray;
+    cinfo->mem->realize_virt_arrays = realize_virt_arrays;
+    cinfo->mem->free_pool = free_pool;
+    cinfo->mem->self_destruct = self_destruct;
+
+    if (limit != 0)
+    {
+        cinfo->mem->request_virt_barray = request_spillable_barray;
+        cinfo->mem->access_virt_barray = access_spillable_barray;
+    }
+    else
+    {
+        cinfo->mem->request_virt_barray = request_virt_barray;
+    }
+}
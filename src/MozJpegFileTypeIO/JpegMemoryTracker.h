@@ -0,0 +1,49 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-mozjpeg, a FileType plugin for Paint.NET
+// that saves JPEG images using the mozjpeg encoder.
+//
+// Copyright (c) 2021, 2022 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MozJpegFileTypeIO.h"
+#include <stdio.h>
+#include <jpeglib.h>
+#include <jerror.h>
+
+struct SpillableBlockArray;
+
+// Wraps the libjpeg memory manager methods to measure how much memory the decoder uses.
+// The sizes are the requested sizes, the memory manager adds a small amount of overhead to each pool.
+struct JpegMemoryTracker
+{
+    // The memory manager methods that are being wrapped.
+    jpeg_memory_mgr original;
+
+    uint64_t limit;
+    uint64_t poolBytes[JPOOL_NUMPOOLS];
+    uint64_t pendingVirtualArrayBytes;
+    uint64_t peakBytes;
+    // The whole-image block arrays that are managed by the tracker when a limit is set.
+    SpillableBlockArray* blockArrays;
+    // The number of bytes that were moved to the temporary files of the block arrays.
+    uint64_t backingStoreBytes;
+};
+
+// A limit of zero does not restrict the memory usage.
+//
+// When a limit is set the tracker manages the whole-image block arrays that progressive and
+// buffered image decoding use. The rows of an array that do not fit under the limit are kept
+// in a temporary file, in the same way as the libjpeg memory manager does with a backing store.
+// The decode fails with JERR_OUT_OF_MEMORY only when the limit is too small for the rows that
+// libjpeg accesses at one time.
+//
+// The max_memory_to_use field of the memory manager is not set, it is a long, which is 32 bits
+// on Windows, and the libjpeg build does not have a backing store of its own.
+void InitializeMemoryTracker(j_common_ptr cinfo, JpegMemoryTracker* tracker, uint64_t limit);
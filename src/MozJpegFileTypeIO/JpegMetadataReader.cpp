@@ -12,94 +12,97 @@
 
 #include "JpegMetadataReader.h"
 #include <stdlib.h>
+#include <string.h>
 #include <limits>
 
 namespace
 {
-    DecodeStatus ReadApp1Blocks(j_decompress_ptr cinfo, const ReadCallbacks* callbacks)
-    {
-        constexpr int App1Marker = JPEG_APP0 + 1;
+    constexpr int App1Marker = JPEG_APP0 + 1;
+
+    constexpr const char* MainExifSignature = "Exif\0\0";
+    constexpr const char* AlternateExifSignature = "Exif\0\xFF";
+    constexpr unsigned int ExifSignatureLength = 6;
+
+    constexpr const char* StandardXmpSignature = "http://ns.adobe.com/xap/1.0/\0";
+    constexpr unsigned int StandardXmpSignatureLength = 29;
 
-        constexpr const char* MainExifSignature = "Exif\0\0";
-        constexpr const char* AlternateExifSignature = "Exif\0\xFF";
-        constexpr unsigned int ExifSignatureLength = 6;
+    constexpr const char* ExtendedXmpSignature = "http://ns.adobe.com/xmp/extension/\0";
+    constexpr unsigned int ExtendedXmpSignatureLength = 35;
 
-        constexpr const char* StandardXmpSignature = "http://ns.adobe.com/xap/1.0/\0";
-        constexpr unsigned int StandardXmpSignatureLength = 29;
+    // Returns false if the marker is not an APP1 block with EXIF or XMP data.
+    bool TryGetApp1BlockType(jpeg_saved_marker_ptr marker, MetadataType* type, unsigned int* signatureLength)
+    {
+        if (marker->marker != App1Marker)
+        {
+            return false;
+        }
 
-        constexpr const char* ExtendedXmpSignature = "http://ns.adobe.com/xmp/extension/\0";
-        constexpr unsigned int ExtendedXmpSignatureLength = 35;
+        if (marker->data_length > ExifSignatureLength &&
+            (memcmp(marker->data, MainExifSignature, ExifSignatureLength) == 0 ||
+             memcmp(marker->data, AlternateExifSignature, ExifSignatureLength) == 0))
+        {
+            *type = MetadataType::Exif;
+            *signatureLength = ExifSignatureLength;
+            return true;
+        }
+        else if (marker->data_length > StandardXmpSignatureLength &&
+                 memcmp(marker->data, StandardXmpSignature, StandardXmpSignatureLength) == 0)
+        {
+            *type = MetadataType::StandardXmp;
+            *signatureLength = StandardXmpSignatureLength;
+            return true;
+        }
+        else if (marker->data_length > ExtendedXmpSignatureLength &&
+                 memcmp(marker->data, ExtendedXmpSignature, ExtendedXmpSignatureLength) == 0)
+        {
+            *type = MetadataType::ExtendedXmp;
+            *signatureLength = ExtendedXmpSignatureLength;
+            return true;
+        }
+
+        return false;
+    }
 
+    DecodeStatus ReadApp1Blocks(j_decompress_ptr cinfo, const ReadCallbacks* callbacks)
+    {
         bool setExif = false;
         bool setStandardXmp = false;
 
         for (jpeg_saved_marker_ptr marker = cinfo->marker_list; marker != nullptr; marker = marker->next)
         {
-            if (marker->marker == App1Marker)
+            MetadataType type;
+            unsigned int signatureLength;
+
+            if (!TryGetApp1BlockType(marker, &type, &signatureLength))
+            {
+                continue;
+            }
+
+            // Only the first EXIF and standard XMP blocks are used.
+            if ((type == MetadataType::Exif && setExif) || (type == MetadataType::StandardXmp && setStandardXmp))
+            {
+                continue;
+            }
+
+            unsigned int length = marker->data_length - signatureLength;
+
+            if (length <= static_cast<unsigned int>(std::numeric_limits<int32_t>::max()))
             {
-                if (marker->data_length > ExifSignatureLength &&
-                    memcmp(marker->data, MainExifSignature, ExifSignatureLength) == 0 ||
-                    memcmp(marker->data, AlternateExifSignature, ExifSignatureLength) == 0)
+                if (!callbacks->setMetadata(
+                    marker->data + signatureLength,
+                    static_cast<int32_t>(length),
+                    type))
                 {
-                    if (setExif)
-                    {
-                        continue;
-                    }
-
-                    unsigned int exifLength = marker->data_length - ExifSignatureLength;
-
-                    if (exifLength > 0 &&
-                        exifLength <= static_cast<unsigned int>(std::numeric_limits<int32_t>::max()))
-                    {
-                        if (!callbacks->setMetadata(
-                            marker->data + ExifSignatureLength,
-                            static_cast<int32_t>(exifLength),
-                            MetadataType::Exif))
-                        {
-                            return DecodeStatus::CallbackError;
-                        }
-                        setExif = true;
-                    }
+                    return DecodeStatus::CallbackError;
                 }
-                else if (marker->data_length > StandardXmpSignatureLength &&
-                         memcmp(marker->data, StandardXmpSignature, StandardXmpSignatureLength) == 0)
+
+                if (type == MetadataType::Exif)
                 {
-                    if (setStandardXmp)
-                    {
-                        continue;
-                    }
-
-                    unsigned int xmpLength = marker->data_length - StandardXmpSignatureLength;
-
-                    if (xmpLength > 0 &&
-                        xmpLength <= static_cast<unsigned int>(std::numeric_limits<int32_t>::max()))
-                    {
-                        if (!callbacks->setMetadata(
-                            marker->data + StandardXmpSignatureLength,
-                            static_cast<int32_t>(xmpLength),
-                            MetadataType::StandardXmp))
-                        {
-                            return DecodeStatus::CallbackError;
-                        }
-                        setStandardXmp = true;
-                    }
+                    setExif = true;
                 }
-                else if (marker->data_length > ExtendedXmpSignatureLength &&
-                         memcmp(marker->data, ExtendedXmpSignature, ExtendedXmpSignatureLength) == 0)
+                else if (type == MetadataType::StandardXmp)
                 {
-                    unsigned int extendedXmpLength = marker->data_length - ExtendedXmpSignatureLength;
-
-                    if (extendedXmpLength > 0 &&
-                        extendedXmpLength <= static_cast<unsigned int>(std::numeric_limits<int32_t>::max()))
-                    {
-                        if (!callbacks->setMetadata(
-                            marker->data + ExtendedXmpSignatureLength,
-                            static_cast<int32_t>(extendedXmpLength),
-                            MetadataType::ExtendedXmp))
-                        {
-                            return DecodeStatus::CallbackError;
-                        }
-                    }
+                    setStandardXmp = true;
                 }
             }
         }
@@ -143,3 +146,67 @@ DecodeStatus ReadMetadata(j_decompress_ptr cinfo, const ReadCallbacks* callbacks
 
     return status;
 }
+
+void ReadMetadataParams(j_decompress_ptr cinfo, MetadataParams* metadata)
+{
+    *metadata = {};
+
+    size_t extendedXmpBlockCount = 0;
+
+    for (jpeg_saved_marker_ptr marker = cinfo->marker_list; marker != nullptr; marker = marker->next)
+    {
+        MetadataType type;
+        unsigned int signatureLength;
+
+        if (TryGetApp1BlockType(marker, &type, &signatureLength))
+        {
+            // The blocks are passed to WriteMetadata with their APP1 signatures.
+            if (type == MetadataType::Exif && metadata->exif == nullptr)
+            {
+                metadata->exif = marker->data;
+                metadata->exifSize = marker->data_length;
+            }
+            else if (type == MetadataType::StandardXmp && metadata->standardXmp == nullptr)
+            {
+                metadata->standardXmp = marker->data;
+                metadata->standardXmpSize = marker->data_length;
+            }
+            else if (type == MetadataType::ExtendedXmp)
+            {
+                extendedXmpBlockCount++;
+            }
+        }
+    }
+
+    if (extendedXmpBlockCount > 0)
+    {
+        metadata->extendedXmpBlocks = static_cast<ExtendedXmpBlock*>((*cinfo->mem->alloc_small)(
+            reinterpret_cast<j_common_ptr>(cinfo),
+            JPOOL_IMAGE,
+            extendedXmpBlockCount * sizeof(ExtendedXmpBlock)));
+
+        for (jpeg_saved_marker_ptr marker = cinfo->marker_list; marker != nullptr; marker = marker->next)
+        {
+            MetadataType type;
+            unsigned int signatureLength;
+
+            if (TryGetApp1BlockType(marker, &type, &signatureLength) && type == MetadataType::ExtendedXmp)
+            {
+                ExtendedXmpBlock* block = &metadata->extendedXmpBlocks[metadata->extendedXmpBlockCount];
+
+                block->data = marker->data;
+                block->length = marker->data_length;
+                metadata->extendedXmpBlockCount++;
+            }
+        }
+    }
+
+    JOCTET* iccProfile;
+    unsigned int iccProfileSize;
+
+    if (jpeg_read_icc_profile(cinfo, &iccProfile, &iccProfileSize))
+    {
+        metadata->iccProfile = iccProfile;
+        metadata->iccProfileSize = iccProfileSize;
+    }
+}
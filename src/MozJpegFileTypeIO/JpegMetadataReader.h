@@ -18,3 +18,8 @@
 #include <jerror.h>
 
 DecodeStatus ReadMetadata(j_decompress_ptr cinfo, const ReadCallbacks* callbacks);
+
+// Fills metadata with the EXIF, XMP and ICC profile blocks of the image in the format that WriteMetadata expects.
+// The EXIF and XMP blocks point to the saved APP1 markers, which are freed when the decompressor is finished
+// or aborted. The ICC profile is allocated by jpeg_read_icc_profile and the caller must free it.
+void ReadMetadataParams(j_decompress_ptr cinfo, MetadataParams* metadata);
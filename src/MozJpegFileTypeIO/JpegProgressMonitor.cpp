@@ -0,0 +1,69 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-mozjpeg, a FileType plugin for Paint.NET
+// that saves JPEG images using the mozjpeg encoder.
+//
+// Copyright (c) 2021, 2022 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "JpegProgressMonitor.h"
+#include "JpegErrorHandler.h"
+
+namespace
+{
+    void progress_monitor(j_common_ptr cinfo)
+    {
+        DecodeProgressContext* ctx = reinterpret_cast<DecodeProgressContext*>(cinfo->progress);
+        j_decompress_ptr dinfo = reinterpret_cast<j_decompress_ptr>(cinfo);
+
+        int32_t progress = 0;
+
+        if (ctx->mgr.total_passes > 0)
+        {
+            double passProgress = 0.0;
+
+            if (ctx->mgr.pass_limit > 0)
+            {
+                passProgress = static_cast<double>(ctx->mgr.pass_counter) / static_cast<double>(ctx->mgr.pass_limit);
+            }
+
+            double progressPercentage = ((ctx->mgr.completed_passes + passProgress) / ctx->mgr.total_passes) * 100.0;
+
+            progress = static_cast<int32_t>(progressPercentage);
+        }
+
+        // Multi-scan images report every scan, even when the percentage has not changed.
+        if (progress == ctx->lastProgress && dinfo->input_scan_number == ctx->lastScanNumber)
+        {
+            return;
+        }
+
+        ctx->lastProgress = progress;
+        ctx->lastScanNumber = dinfo->input_scan_number;
+
+        if (!ctx->callback(progress, dinfo->input_scan_number, dinfo->output_scanline))
+        {
+            ctx->canceled = true;
+
+            longjmp(reinterpret_cast<JpegErrorContext*>(cinfo->err)->setjmpBuffer, 1);
+        }
+    }
+}
+
+void InitializeDecodeProgressMonitor(
+    j_decompress_ptr cinfo,
+    DecodeProgressContext* context,
+    DecodeProgressCallback callback)
+{
+    context->mgr.progress_monitor = progress_monitor;
+    context->callback = callback;
+    context->lastProgress = -1;
+    context->lastScanNumber = -1;
+    context->canceled = false;
+
+    cinfo->progress = &context->mgr;
+}
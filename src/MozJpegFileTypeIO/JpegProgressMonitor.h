@@ -0,0 +1,35 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-mozjpeg, a FileType plugin for Paint.NET
+// that saves JPEG images using the mozjpeg encoder.
+//
+// Copyright (c) 2021, 2022 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MozJpegFileTypeIO.h"
+#include <stdio.h>
+#include <jpeglib.h>
+#include <jerror.h>
+
+struct DecodeProgressContext
+{
+    jpeg_progress_mgr mgr;
+
+    DecodeProgressCallback callback;
+    int32_t lastProgress;
+    int lastScanNumber;
+    bool canceled;
+};
+
+// The JPEG error manager must be a JpegErrorContext, canceling the decode
+// jumps to its setjmp buffer with the canceled field set.
+void InitializeDecodeProgressMonitor(
+    j_decompress_ptr cinfo,
+    DecodeProgressContext* context,
+    DecodeProgressCallback callback);
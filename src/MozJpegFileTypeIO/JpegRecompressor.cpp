@@ -0,0 +1,223 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-mozjpeg, a FileType plugin for Paint.NET
+// that saves JPEG images using the mozjpeg encoder.
+//
+// Copyright (c) 2021, 2022 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "MozJpegFileTypeIO.h"
+#include "JpegDestiniationManager.h"
+#include "JpegErrorHandler.h"
+#include "JpegMetadataReader.h"
+#include "JpegMetadataWriter.h"
+#include "JpegSourceManager.h"
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+
+namespace
+{
+    // Replaces the quantization tables that were copied from the source with the tables for the target quality.
+    // A table entry is never made finer than the source, that would only spend bits on the existing quantization error.
+    void SetRequantizationTables(j_decompress_ptr dinfo, j_compress_ptr cinfo, int quality)
+    {
+        jpeg_set_quality(cinfo, quality, true);
+
+        UINT16 luminanceTable[DCTSIZE2];
+        UINT16 chrominanceTable[DCTSIZE2];
+
+        memcpy(luminanceTable, cinfo->quant_tbl_ptrs[0]->quantval, sizeof(luminanceTable));
+        memcpy(chrominanceTable, cinfo->quant_tbl_ptrs[1]->quantval, sizeof(chrominanceTable));
+
+        bool tableSet[NUM_QUANT_TBLS] = {};
+
+        for (int ci = 0; ci < cinfo->num_components; ci++)
+        {
+            const int tableIndex = cinfo->comp_info[ci].quant_tbl_no;
+
+            if (tableSet[tableIndex])
+            {
+                continue;
+            }
+
+            const JQUANT_TBL* sourceTable = dinfo->quant_tbl_ptrs[tableIndex];
+            const UINT16* targetTable = ci == 0 ? luminanceTable : chrominanceTable;
+
+            if (cinfo->quant_tbl_ptrs[tableIndex] == nullptr)
+            {
+                cinfo->quant_tbl_ptrs[tableIndex] = jpeg_alloc_quant_table(reinterpret_cast<j_common_ptr>(cinfo));
+            }
+
+            JQUANT_TBL* destinationTable = cinfo->quant_tbl_ptrs[tableIndex];
+
+            for (int i = 0; i < DCTSIZE2; i++)
+            {
+                destinationTable->quantval[i] = std::max(sourceTable->quantval[i], targetTable[i]);
+            }
+
+            destinationTable->sent_table = false;
+            tableSet[tableIndex] = true;
+        }
+    }
+
+    inline JCOEF Requantize(JCOEF coefficient, int sourceQuantizer, int destinationQuantizer)
+    {
+        const int value = coefficient * sourceQuantizer;
+        const int halfQuantizer = destinationQuantizer / 2;
+
+        if (value >= 0)
+        {
+            return static_cast<JCOEF>((value + halfQuantizer) / destinationQuantizer);
+        }
+        else
+        {
+            return static_cast<JCOEF>(-((halfQuantizer - value) / destinationQuantizer));
+        }
+    }
+
+    void RequantizeCoefficients(j_decompress_ptr dinfo, jvirt_barray_ptr* coefficients, j_compress_ptr cinfo)
+    {
+        for (int ci = 0; ci < dinfo->num_components; ci++)
+        {
+            const jpeg_component_info* component = &dinfo->comp_info[ci];
+            const JQUANT_TBL* sourceTable = dinfo->quant_tbl_ptrs[component->quant_tbl_no];
+            const JQUANT_TBL* destinationTable = cinfo->quant_tbl_ptrs[cinfo->comp_info[ci].quant_tbl_no];
+
+            if (memcmp(sourceTable->quantval, destinationTable->quantval, sizeof(sourceTable->quantval)) == 0)
+            {
+                continue;
+            }
+
+            for (JDIMENSION blockRow = 0; blockRow < component->height_in_blocks; blockRow++)
+            {
+                JBLOCKARRAY blocks = (*dinfo->mem->access_virt_barray)(
+                    reinterpret_cast<j_common_ptr>(dinfo),
+                    coefficients[ci],
+                    blockRow,
+                    1,
+                    true);
+
+                JBLOCKROW row = blocks[0];
+
+                for (JDIMENSION blockColumn = 0; blockColumn < component->width_in_blocks; blockColumn++)
+                {
+                    JCOEF* block = row[blockColumn];
+
+                    for (int i = 0; i < DCTSIZE2; i++)
+                    {
+                        const int sourceQuantizer = sourceTable->quantval[i];
+                        const int destinationQuantizer = destinationTable->quantval[i];
+
+                        if (sourceQuantizer != destinationQuantizer)
+                        {
+                            block[i] = Requantize(block[i], sourceQuantizer, destinationQuantizer);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    EncodeStatus RecompressImage(
+        const ReadCallbacks* callbacks,
+        const RecompressOptions* options,
+        MetadataParams* metadata,
+        JpegLibraryErrorInfo* errorInfo,
+        WriteCallback writeCallback)
+    {
+        JpegErrorContext errorContext{};
+        jpeg_decompress_struct dinfo{};
+        jpeg_compress_struct cinfo{};
+
+        dinfo.err = jpeg_std_error(&errorContext.mgr);
+        dinfo.err->error_exit = error_exit;
+        cinfo.err = dinfo.err;
+        memset(errorContext.messageBuffer, 0, _countof(errorContext.messageBuffer));
+
+        if (setjmp(errorContext.setjmpBuffer))
+        {
+            // This block will be jumped to if the JPEG error_exit method is called.
+            jpeg_destroy_compress(&cinfo);
+            jpeg_destroy_decompress(&dinfo);
+
+            HandleErrorMessage(errorContext, errorInfo);
+            return EncodeStatus::JpegLibraryError;
+        }
+
+        jpeg_create_decompress(&dinfo);
+
+        InitializeSourceManager(&dinfo, callbacks);
+
+        // Save the EXIF and/or XMP data.
+        jpeg_save_markers(&dinfo, JPEG_APP0 + 1, 0xFFFF);
+        // Save the ICC profile.
+        jpeg_save_markers(&dinfo, JPEG_APP0 + 2, 0xFFFF);
+
+        jpeg_read_header(&dinfo, true);
+
+        // The quantized DCT coefficients are read without the IDCT, upsampling and color conversion.
+        jvirt_barray_ptr* coefficients = jpeg_read_coefficients(&dinfo);
+
+        ReadMetadataParams(&dinfo, metadata);
+
+        jpeg_create_compress(&cinfo);
+
+        InitializeDestinationManager(&cinfo, writeCallback);
+
+        jpeg_copy_critical_parameters(&dinfo, &cinfo);
+
+        SetRequantizationTables(&dinfo, &cinfo, options->quality);
+        RequantizeCoefficients(&dinfo, coefficients, &cinfo);
+
+        cinfo.optimize_coding = true;
+
+        if (options->progressive)
+        {
+            jpeg_simple_progression(&cinfo);
+        }
+        else
+        {
+            cinfo.num_scans = 0;
+            cinfo.scan_info = nullptr;
+        }
+
+        jpeg_write_coefficients(&cinfo, coefficients);
+
+        // The saved markers are freed by jpeg_finish_decompress, so the metadata must be written first.
+        WriteMetadata(&cinfo, metadata);
+
+        jpeg_finish_compress(&cinfo);
+        jpeg_destroy_compress(&cinfo);
+
+        jpeg_finish_decompress(&dinfo);
+        jpeg_destroy_decompress(&dinfo);
+
+        return EncodeStatus::Ok;
+    }
+}
+
+EncodeStatus RecompressJpeg(
+    const ReadCallbacks* callbacks,
+    const RecompressOptions* options,
+    JpegLibraryErrorInfo* errorInfo,
+    WriteCallback writeCallback)
+{
+    if (callbacks == nullptr || options == nullptr || errorInfo == nullptr || writeCallback == nullptr)
+    {
+        return EncodeStatus::NullParameter;
+    }
+
+    // The metadata is kept outside of the setjmp frame, the ICC profile must be freed after an error.
+    MetadataParams metadata{};
+
+    EncodeStatus status = RecompressImage(callbacks, options, &metadata, errorInfo, writeCallback);
+
+    free(metadata.iccProfile);
+
+    return status;
+}
@@ -12,10 +12,18 @@
 
 #include "MozJpegFileTypeIO.h"
 #include "JpegDestiniationManager.h"
+#include "JpegEncoderProgress.h"
+#include "JpegEncoderSettings.h"
+#include "JpegErrorHandler.h"
+#include "JpegMemoryDestinationManager.h"
+#include "JpegMemoryTracker.h"
 #include "JpegMetadataReader.h"
 #include "JpegMetadataWriter.h"
+#include "JpegProgressMonitor.h"
 #include "JpegSourceManager.h"
+#include "TrialEncoder.h"
 #include <stdlib.h>
+#include <algorithm>
 #include <memory>
 #include <new>
 #include <stdio.h>
@@ -25,133 +33,516 @@
 
 namespace
 {
-    struct JpegErrorContext
+    struct ColorBgra
     {
-        jpeg_error_mgr mgr;
-
-        char messageBuffer[JMSG_LENGTH_MAX];
-        jmp_buf setjmpBuffer;
+        uint8_t b;
+        uint8_t g;
+        uint8_t r;
+        uint8_t a;
     };
 
-    void error_exit(j_common_ptr cinfo)
+    DecodeStatus SetOutputColorSpace(j_decompress_ptr dinfo, OutputPixelFormat format)
     {
-        JpegErrorContext* ctx = reinterpret_cast<JpegErrorContext*>(cinfo->err);
-
-        switch (ctx->mgr.msg_code)
+        switch (format)
         {
-        case JERR_FILE_READ:
-            strcpy_s(ctx->messageBuffer, "File read error.");
+        case OutputPixelFormat::Bgra32:
+            dinfo->out_color_space = JCS_EXT_BGRA;
             break;
-        case JERR_FILE_WRITE:
-            strcpy_s(ctx->messageBuffer, "File write error.");
+        case OutputPixelFormat::Bgr24:
+            dinfo->out_color_space = JCS_EXT_BGR;
             break;
-        default:
-            ctx->mgr.format_message(reinterpret_cast<j_common_ptr>(cinfo), ctx->messageBuffer);
+        case OutputPixelFormat::Rgba32:
+            dinfo->out_color_space = JCS_EXT_RGBA;
             break;
+        case OutputPixelFormat::Gray8:
+            dinfo->out_color_space = JCS_GRAYSCALE;
+            break;
+        case OutputPixelFormat::PlanarYCbCr:
+            // The raw data path bypasses color conversion, so it can only be used
+            // when the image is already stored as YCbCr or gray-scale.
+            if (dinfo->jpeg_color_space != JCS_YCbCr && dinfo->jpeg_color_space != JCS_GRAYSCALE)
+            {
+                return DecodeStatus::UnsupportedOutputFormat;
+            }
+
+            dinfo->out_color_space = dinfo->jpeg_color_space;
+            dinfo->raw_data_out = true;
+            break;
+        default:
+            return DecodeStatus::UnsupportedOutputFormat;
         }
 
-        longjmp(ctx->setjmpBuffer, 1);
+        return DecodeStatus::Ok;
     }
 
-    void HandleErrorMessage(const JpegErrorContext& ctx, JpegLibraryErrorInfo* info)
+    void SetDecodeQuality(j_decompress_ptr dinfo, const DecodeOptions* options)
     {
-        const size_t errorMessageLength = strlen(ctx.messageBuffer);
-
-        if (errorMessageLength > 0 && errorMessageLength <= JpegLibraryErrorInfo::maxErrorMessageLength)
+        if (options != nullptr && options->quality == DecodeQuality::Fast)
         {
-            strncpy_s(info->errorMessage, ctx.messageBuffer, errorMessageLength);
+            dinfo->dct_method = JDCT_IFAST;
+            // Disabling fancy upsampling allows libjpeg to use the merged upsampler,
+            // which combines chroma upsampling with the color conversion.
+            dinfo->do_fancy_upsampling = false;
+            dinfo->do_block_smoothing = false;
         }
     }
 
-    struct ColorBgra
+    // In buffered image mode the decoder reads the scans up to maxScans, and the output pass
+    // only uses those scans. The rest of the file is never read.
+    void StartDecompress(j_decompress_ptr dinfo, int32_t maxScans)
     {
-        uint8_t b;
-        uint8_t g;
-        uint8_t r;
-        uint8_t a;
-    };
-}
+        jpeg_start_decompress(dinfo);
 
-DecodeStatus ReadImage(
-    const ReadCallbacks* callbacks,
-    JpegLibraryErrorInfo* errorInfo)
-{
-    if (callbacks == nullptr || errorInfo == nullptr)
+        if (dinfo->buffered_image)
+        {
+            int result;
+
+            do
+            {
+                result = jpeg_consume_input(dinfo);
+            } while (result != JPEG_REACHED_EOI &&
+                     result != JPEG_SUSPENDED &&
+                     !(result == JPEG_SCAN_COMPLETED && dinfo->input_scan_number >= maxScans));
+
+            jpeg_start_output(dinfo, dinfo->input_scan_number);
+        }
+    }
+
+    void FinishOutput(j_decompress_ptr dinfo)
     {
-        return DecodeStatus::NullParameter;
+        if (dinfo->buffered_image)
+        {
+            jpeg_finish_output(dinfo);
+        }
     }
 
-    JpegErrorContext errorContext{};
-    jpeg_decompress_struct dinfo{};
+    DecodeStatus ReadInterleavedImage(j_decompress_ptr dinfo, const ReadCallbacks* callbacks, int32_t maxScans)
+    {
+        int32_t outputImageStride = 0;
 
-    dinfo.err = jpeg_std_error(&errorContext.mgr);
-    dinfo.err->error_exit = error_exit;
-    memset(errorContext.messageBuffer, 0, _countof(errorContext.messageBuffer));
+        uint8_t* outputImageScan0 = callbacks->allocateSurface(dinfo->output_width, dinfo->output_height, &outputImageStride);
 
-    if (setjmp(errorContext.setjmpBuffer))
-    {
-        // This block will be jumped to if the JPEG error_exit method is called.
-        jpeg_destroy_decompress(&dinfo);
+        if (outputImageScan0 == nullptr)
+        {
+            return DecodeStatus::CallbackError;
+        }
 
-        HandleErrorMessage(errorContext, errorInfo);
-        return DecodeStatus::JpegLibraryError;
+        StartDecompress(dinfo, maxScans);
+
+        while (dinfo->output_scanline < dinfo->output_height)
+        {
+            uint8_t* dest = outputImageScan0 + (static_cast<size_t>(dinfo->output_scanline) * outputImageStride);
+
+            jpeg_read_scanlines(dinfo, &dest, 1);
+        }
+
+        FinishOutput(dinfo);
+
+        return DecodeStatus::Ok;
     }
 
-    jpeg_create_decompress(&dinfo);
+    DecodeStatus ReadPlanarImage(j_decompress_ptr dinfo, const ReadCallbacks* callbacks, int32_t maxScans)
+    {
+        if (callbacks->allocatePlane == nullptr)
+        {
+            return DecodeStatus::NullParameter;
+        }
 
-    InitializeSourceManager(&dinfo, callbacks);
+        const int planeCount = dinfo->num_components;
 
-    // Save the EXIF and/or XMP data.
-    jpeg_save_markers(&dinfo, JPEG_APP0 + 1, 0xFFFF);
-    // Save the ICC profile.
-    jpeg_save_markers(&dinfo, JPEG_APP0 + 2, 0xFFFF);
+        uint8_t* planeScan0[MAX_COMPONENTS]{};
+        int32_t planeStride[MAX_COMPONENTS]{};
+        JSAMPARRAY componentBuffers[MAX_COMPONENTS]{};
 
-    jpeg_read_header(&dinfo, true);
+        for (int i = 0; i < planeCount; i++)
+        {
+            const jpeg_component_info* component = &dinfo->comp_info[i];
 
-    dinfo.out_color_space = JCS_EXT_BGRA;
+            planeScan0[i] = callbacks->allocatePlane(
+                i,
+                static_cast<int32_t>(component->downsampled_width),
+                static_cast<int32_t>(component->downsampled_height),
+                &planeStride[i]);
 
-    jpeg_calc_output_dimensions(&dinfo);
+            if (planeScan0[i] == nullptr)
+            {
+                return DecodeStatus::CallbackError;
+            }
 
-    if (dinfo.output_width > static_cast<JDIMENSION>(std::numeric_limits<int32_t>::max()) ||
-        dinfo.output_height > static_cast<JDIMENSION>(std::numeric_limits<int32_t>::max()))
-    {
-        jpeg_destroy_decompress(&dinfo);
+            // jpeg_read_raw_data writes whole DCT blocks, so it needs a scratch buffer
+            // that is padded to the block width of the component.
+            componentBuffers[i] = (*dinfo->mem->alloc_sarray)(
+                reinterpret_cast<j_common_ptr>(dinfo),
+                JPOOL_IMAGE,
+                component->width_in_blocks * DCTSIZE,
+                component->v_samp_factor * DCTSIZE);
+        }
+
+        StartDecompress(dinfo, maxScans);
 
-        return DecodeStatus::OutOfMemory;
+        const JDIMENSION rowsPerIMCU = dinfo->max_v_samp_factor * DCTSIZE;
+
+        while (dinfo->output_scanline < dinfo->output_height)
+        {
+            const JDIMENSION iMCURow = dinfo->output_scanline / rowsPerIMCU;
+
+            jpeg_read_raw_data(dinfo, componentBuffers, rowsPerIMCU);
+
+            for (int i = 0; i < planeCount; i++)
+            {
+                const jpeg_component_info* component = &dinfo->comp_info[i];
+                const JDIMENSION componentRows = component->v_samp_factor * DCTSIZE;
+                const JDIMENSION firstRow = iMCURow * componentRows;
+
+                if (firstRow >= component->downsampled_height)
+                {
+                    continue;
+                }
+
+                const JDIMENSION rowCount = std::min(componentRows, component->downsampled_height - firstRow);
+
+                for (JDIMENSION y = 0; y < rowCount; y++)
+                {
+                    uint8_t* dest = planeScan0[i] + (static_cast<size_t>(firstRow + y) * planeStride[i]);
+
+                    memcpy(dest, componentBuffers[i][y], component->downsampled_width);
+                }
+            }
+        }
+
+        FinishOutput(dinfo);
+
+        return DecodeStatus::Ok;
     }
 
-    int32_t outputImageStride = 0;
+    // The largest single allocation the libjpeg memory manager allows, see MAX_ALLOC_CHUNK in jmemsys.h.
+    // The alloc_large method rejects any request larger than MAX_ALLOC_CHUNK minus the size of its
+    // pool header and the alignment padding, so the band buffer keeps a margin below the limit.
+    constexpr uint64_t MaxAllocChunk = 1000000000;
+    constexpr uint64_t LargePoolHeaderMargin = 128;
+    constexpr uint64_t MaxRowBandBufferSize = MaxAllocChunk - LargePoolHeaderMargin;
+
+    DecodeStatus ReadRowBands(j_decompress_ptr dinfo, const RowBandOptions* rowBands, int32_t maxScans)
+    {
+        const uint64_t rowBytes = static_cast<uint64_t>(dinfo->output_width) * dinfo->output_components;
+
+        if (rowBytes > MaxRowBandBufferSize)
+        {
+            return DecodeStatus::OutOfMemory;
+        }
+
+        uint64_t bandHeight = rowBands->bandHeight > 0
+            ? static_cast<uint64_t>(rowBands->bandHeight)
+            : static_cast<uint64_t>(dinfo->max_v_samp_factor) * DCTSIZE;
+
+        bandHeight = std::min(bandHeight, MaxRowBandBufferSize / rowBytes);
+        bandHeight = std::min(bandHeight, static_cast<uint64_t>(dinfo->output_height));
+
+        uint8_t* band = static_cast<uint8_t*>((*dinfo->mem->alloc_large)(
+            reinterpret_cast<j_common_ptr>(dinfo),
+            JPOOL_IMAGE,
+            static_cast<size_t>(rowBytes * bandHeight)));
+
+        StartDecompress(dinfo, maxScans);
+
+        while (dinfo->output_scanline < dinfo->output_height)
+        {
+            const JDIMENSION firstRow = dinfo->output_scanline;
+            const JDIMENSION rowCount = static_cast<JDIMENSION>(
+                std::min(bandHeight, static_cast<uint64_t>(dinfo->output_height - firstRow)));
+
+            while (dinfo->output_scanline < firstRow + rowCount)
+            {
+                uint8_t* dest = band + static_cast<size_t>((dinfo->output_scanline - firstRow) * rowBytes);
+
+                jpeg_read_scanlines(dinfo, &dest, 1);
+            }
 
-    uint8_t* outputImageScan0 = callbacks->allocateSurface(dinfo.output_width, dinfo.output_height, &outputImageStride);
+            // The offset is relative to a tightly packed image, so it may exceed 4 GB.
+            const uint64_t firstRowOffset = static_cast<uint64_t>(firstRow) * rowBytes;
 
-    if (outputImageScan0 == nullptr)
+            if (!rowBands->consumeRows(
+                band,
+                firstRow,
+                static_cast<int32_t>(rowCount),
+                static_cast<size_t>(rowBytes),
+                firstRowOffset))
+            {
+                return DecodeStatus::CallbackError;
+            }
+        }
+
+        FinishOutput(dinfo);
+
+        return DecodeStatus::Ok;
+    }
+
+    // When rowBands is null the image is decoded into a single surface from the allocateSurface callback.
+    DecodeStatus DecodeImage(
+        const ReadCallbacks* callbacks,
+        const DecodeOptions* options,
+        const RowBandOptions* rowBands,
+        DecodeStatistics* statistics,
+        JpegLibraryErrorInfo* errorInfo)
     {
+        JpegErrorContext errorContext{};
+        DecodeProgressContext progressContext{};
+        JpegMemoryTracker memoryTracker{};
+        jpeg_decompress_struct dinfo{};
+
+        dinfo.err = jpeg_std_error(&errorContext.mgr);
+        dinfo.err->error_exit = error_exit;
+        memset(errorContext.messageBuffer, 0, _countof(errorContext.messageBuffer));
+
+        if (statistics != nullptr)
+        {
+            statistics->peakMemoryUsage = 0;
+            statistics->backingStoreBytes = 0;
+        }
+
+        if (setjmp(errorContext.setjmpBuffer))
+        {
+            // This block will be jumped to if the JPEG error_exit method is called,
+            // or if the progress callback canceled the decode.
+            jpeg_destroy_decompress(&dinfo);
+
+            if (statistics != nullptr)
+            {
+                statistics->peakMemoryUsage = memoryTracker.peakBytes;
+                statistics->backingStoreBytes = memoryTracker.backingStoreBytes;
+            }
+
+            if (progressContext.canceled)
+            {
+                return DecodeStatus::UserCanceled;
+            }
+
+            if (errorContext.mgr.msg_code == JERR_OUT_OF_MEMORY)
+            {
+                return DecodeStatus::OutOfMemory;
+            }
+
+            HandleErrorMessage(errorContext, errorInfo);
+            return DecodeStatus::JpegLibraryError;
+        }
+
+        jpeg_create_decompress(&dinfo);
+
+        InitializeMemoryTracker(
+            reinterpret_cast<j_common_ptr>(&dinfo),
+            &memoryTracker,
+            options != nullptr && options->maxMemoryToUse > 0 ? static_cast<uint64_t>(options->maxMemoryToUse) : 0);
+
+        InitializeSourceManager(&dinfo, callbacks);
+
+        if (callbacks->progress != nullptr)
+        {
+            InitializeDecodeProgressMonitor(&dinfo, &progressContext, callbacks->progress);
+        }
+
+        // Save the EXIF and/or XMP data.
+        jpeg_save_markers(&dinfo, JPEG_APP0 + 1, 0xFFFF);
+        // Save the ICC profile.
+        jpeg_save_markers(&dinfo, JPEG_APP0 + 2, 0xFFFF);
+
+        jpeg_read_header(&dinfo, true);
+
+        OutputPixelFormat outputFormat = OutputPixelFormat::Bgra32;
+
+        if (callbacks->selectOutputFormat != nullptr)
+        {
+            outputFormat = callbacks->selectOutputFormat(dinfo.num_components);
+        }
+
+        DecodeStatus status = SetOutputColorSpace(&dinfo, outputFormat);
+
+        if (status != DecodeStatus::Ok)
+        {
+            jpeg_destroy_decompress(&dinfo);
+
+            return status;
+        }
+
+        SetDecodeQuality(&dinfo, options);
+
+        const int32_t maxScans = options != nullptr ? options->maxScans : 0;
+
+        if (maxScans > 0 && jpeg_has_multiple_scans(&dinfo))
+        {
+            dinfo.buffered_image = true;
+        }
+
+        jpeg_calc_output_dimensions(&dinfo);
+
+        if (dinfo.output_width > static_cast<JDIMENSION>(std::numeric_limits<int32_t>::max()) ||
+            dinfo.output_height > static_cast<JDIMENSION>(std::numeric_limits<int32_t>::max()))
+        {
+            jpeg_destroy_decompress(&dinfo);
+
+            return DecodeStatus::OutOfMemory;
+        }
+
+        if (rowBands != nullptr)
+        {
+            if (outputFormat == OutputPixelFormat::PlanarYCbCr)
+            {
+                status = DecodeStatus::UnsupportedOutputFormat;
+            }
+            else
+            {
+                status = ReadRowBands(&dinfo, rowBands, maxScans);
+            }
+        }
+        else if (outputFormat == OutputPixelFormat::PlanarYCbCr)
+        {
+            status = ReadPlanarImage(&dinfo, callbacks, maxScans);
+        }
+        else
+        {
+            status = ReadInterleavedImage(&dinfo, callbacks, maxScans);
+        }
+
+        if (status != DecodeStatus::Ok)
+        {
+            jpeg_destroy_decompress(&dinfo);
+
+            return status;
+        }
+
+        status = ReadMetadata(&dinfo, callbacks);
+
+        if (dinfo.buffered_image)
+        {
+            // jpeg_finish_decompress would read the scans that were skipped.
+            jpeg_abort_decompress(&dinfo);
+        }
+        else
+        {
+            jpeg_finish_decompress(&dinfo);
+        }
+
         jpeg_destroy_decompress(&dinfo);
 
-        return DecodeStatus::CallbackError;
+        if (statistics != nullptr)
+        {
+            statistics->peakMemoryUsage = memoryTracker.peakBytes;
+            statistics->backingStoreBytes = memoryTracker.backingStoreBytes;
+        }
+
+        return status;
     }
 
-    jpeg_start_decompress(&dinfo);
+    EncodeStatus CompressOptimizedReference(
+        const BitmapData* bgraImage,
+        const EncodeOptions* options,
+        const MetadataParams* metadata,
+        MemoryDestination* output,
+        JpegLibraryErrorInfo* errorInfo)
+    {
+        JpegErrorContext errorContext{};
+        jpeg_compress_struct cinfo{};
+
+        cinfo.err = jpeg_std_error(&errorContext.mgr);
+        cinfo.err->error_exit = error_exit;
+        memset(errorContext.messageBuffer, 0, _countof(errorContext.messageBuffer));
+
+        if (setjmp(errorContext.setjmpBuffer))
+        {
+            // This block will be jumped to if the JPEG error_exit method is called.
+            jpeg_destroy_compress(&cinfo);
+
+            HandleErrorMessage(errorContext, errorInfo);
+            return EncodeStatus::JpegLibraryError;
+        }
+
+        jpeg_create_compress(&cinfo);
+
+        InitializeMemoryDestinationManager(&cinfo, output);
+
+        SetEncoderSettings(
+            &cinfo,
+            bgraImage,
+            options->quality,
+            options->chromaSubsampling,
+            false,
+            true);
+        // Only the Huffman tables differ from the single pass encode, so the size
+        // difference is the penalty of using the fixed tables.
+        cinfo.optimize_coding = true;
+
+        jpeg_start_compress(&cinfo, true);
+
+        WriteMetadata(&cinfo, metadata);
+
+        while (cinfo.next_scanline < cinfo.image_height)
+        {
+            uint8_t* srcRow = bgraImage->scan0 + (static_cast<size_t>(cinfo.next_scanline) * bgraImage->stride);
+
+            jpeg_write_scanlines(&cinfo, &srcRow, 1);
+        }
+
+        jpeg_finish_compress(&cinfo);
+        jpeg_destroy_compress(&cinfo);
+
+        return EncodeStatus::Ok;
+    }
 
-    while (dinfo.output_scanline < dinfo.output_height)
+    EncodeStatus MeasureOptimizedSize(
+        const BitmapData* bgraImage,
+        const EncodeOptions* options,
+        const MetadataParams* metadata,
+        JpegLibraryErrorInfo* errorInfo,
+        uint64_t* optimizedSize)
     {
-        uint8_t* dest = outputImageScan0 + (dinfo.output_scanline * outputImageStride);
+        MemoryDestination output{};
+
+        const EncodeStatus status = CompressOptimizedReference(bgraImage, options, metadata, &output, errorInfo);
+
+        if (status == EncodeStatus::Ok)
+        {
+            *optimizedSize = output.size;
+        }
+
+        FreeMemoryDestination(&output);
+
+        return status;
+    }
+}
 
-        jpeg_read_scanlines(&dinfo, &dest, 1);
+DecodeStatus ReadImage(
+    const ReadCallbacks* callbacks,
+    const DecodeOptions* options,
+    DecodeStatistics* statistics,
+    JpegLibraryErrorInfo* errorInfo)
+{
+    if (callbacks == nullptr || errorInfo == nullptr)
+    {
+        return DecodeStatus::NullParameter;
     }
 
-    DecodeStatus status = ReadMetadata(&dinfo, callbacks);
+    return DecodeImage(callbacks, options, nullptr, statistics, errorInfo);
+}
 
-    jpeg_finish_decompress(&dinfo);
-    jpeg_destroy_decompress(&dinfo);
+DecodeStatus ReadImageRows(
+    const ReadCallbacks* callbacks,
+    const DecodeOptions* options,
+    const RowBandOptions* rowBands,
+    DecodeStatistics* statistics,
+    JpegLibraryErrorInfo* errorInfo)
+{
+    if (callbacks == nullptr || rowBands == nullptr || rowBands->consumeRows == nullptr || errorInfo == nullptr)
+    {
+        return DecodeStatus::NullParameter;
+    }
 
-    return status;
+    return DecodeImage(callbacks, options, rowBands, statistics, errorInfo);
 }
 
 EncodeStatus WriteImage(
     const BitmapData* bgraImage,
     const EncodeOptions* options,
     const MetadataParams* metadata,
+    EncodeStatistics* statistics,
     JpegLibraryErrorInfo* errorInfo,
     ProgressCallback progressCallback,
     WriteCallback writeCallback)
@@ -161,6 +552,17 @@ EncodeStatus WriteImage(
         return EncodeStatus::NullParameter;
     }
 
+    if (statistics != nullptr)
+    {
+        statistics->outputSize = 0;
+        statistics->optimizedSize = 0;
+    }
+
+    if (options->autoSelect && !options->singlePass)
+    {
+        return TrialEncodeImage(bgraImage, options, metadata, errorInfo, progressCallback, writeCallback);
+    }
+
     JpegErrorContext errorContext{};
     jpeg_compress_struct cinfo{};
 
@@ -181,95 +583,38 @@ EncodeStatus WriteImage(
 
     InitializeDestinationManager(&cinfo, writeCallback);
 
-    const bool isGrayscale = options->chromaSubsampling == ChromaSubsampling::Subsampling400;
-
-    cinfo.image_width = bgraImage->width;
-    cinfo.image_height = bgraImage->height;
-    cinfo.input_components = isGrayscale ? 1 : 3;
-#pragma warning(suppress: 26812) // Suppress C26812: Prefer 'enum class' over 'enum'.
-    cinfo.in_color_space = JCS_EXT_BGRX;
-
-    jpeg_set_defaults(&cinfo);
-    jpeg_set_colorspace(&cinfo, isGrayscale ? JCS_GRAYSCALE : JCS_YCbCr);
-
-    jpeg_set_quality(&cinfo, options->quality, !options->progressive);
-    cinfo.optimize_coding = true;
-
-    if (options->progressive)
-    {
-        jpeg_simple_progression(&cinfo);
-    }
-
-    if (isGrayscale)
-    {
-        cinfo.comp_info[0].h_samp_factor = 1;
-        cinfo.comp_info[0].v_samp_factor = 1;
-    }
-    else
-    {
-        switch (options->chromaSubsampling)
-        {
-
-        case ChromaSubsampling::Subsampling420:
-            cinfo.comp_info[0].h_samp_factor = 2;
-            cinfo.comp_info[0].v_samp_factor = 2;
-            cinfo.comp_info[1].h_samp_factor = 1;
-            cinfo.comp_info[1].v_samp_factor = 1;
-            cinfo.comp_info[2].h_samp_factor = 1;
-            cinfo.comp_info[2].v_samp_factor = 1;
-            break;
-        case ChromaSubsampling::Subsampling422:
-            cinfo.comp_info[0].h_samp_factor = 2;
-            cinfo.comp_info[0].v_samp_factor = 1;
-            cinfo.comp_info[1].h_samp_factor = 1;
-            cinfo.comp_info[1].v_samp_factor = 1;
-            cinfo.comp_info[2].h_samp_factor = 1;
-            cinfo.comp_info[2].v_samp_factor = 1;
-            break;
-        case ChromaSubsampling::Subsampling444:
-            cinfo.comp_info[0].h_samp_factor = 1;
-            cinfo.comp_info[0].v_samp_factor = 1;
-            cinfo.comp_info[1].h_samp_factor = 1;
-            cinfo.comp_info[1].v_samp_factor = 1;
-            cinfo.comp_info[2].h_samp_factor = 1;
-            cinfo.comp_info[2].v_samp_factor = 1;
-            break;
-        }
-    }
+    SetEncoderSettings(
+        &cinfo,
+        bgraImage,
+        options->quality,
+        options->chromaSubsampling,
+        options->progressive,
+        options->singlePass);
 
     jpeg_start_compress(&cinfo, true);
 
     WriteMetadata(&cinfo, metadata);
 
-    int32_t currentProgressPercentage = -1;
-
-    while (cinfo.next_scanline < cinfo.image_height)
+    if (!WriteScanlines(&cinfo, bgraImage, progressCallback))
     {
-        if (progressCallback != nullptr)
-        {
-            double progressPercentage = (static_cast<double>(cinfo.next_scanline) / static_cast<double>(cinfo.image_height)) * 100.0;
-            int32_t roundedPercentage = static_cast<int32_t>(round(progressPercentage));
-
-            if (currentProgressPercentage != roundedPercentage)
-            {
-                currentProgressPercentage = roundedPercentage;
-
-                if (!progressCallback(currentProgressPercentage))
-                {
-                    jpeg_destroy_compress(&cinfo);
+        jpeg_destroy_compress(&cinfo);
 
-                    return EncodeStatus::UserCanceled;
-                }
-            }
-        }
+        return EncodeStatus::UserCanceled;
+    }
 
-        uint8_t* srcRow = bgraImage->scan0 + (static_cast<size_t>(cinfo.next_scanline) * bgraImage->stride);
+    jpeg_finish_compress(&cinfo);
 
-        jpeg_write_scanlines(&cinfo, &srcRow, 1);
+    if (statistics != nullptr)
+    {
+        statistics->outputSize = GetBytesWritten(&cinfo);
     }
 
-    jpeg_finish_compress(&cinfo);
     jpeg_destroy_compress(&cinfo);
 
+    if (statistics != nullptr && options->singlePass)
+    {
+        return MeasureOptimizedSize(bgraImage, options, metadata, errorInfo, &statistics->optimizedSize);
+    }
+
     return EncodeStatus::Ok;
 }
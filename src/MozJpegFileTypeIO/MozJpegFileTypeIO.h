@@ -34,12 +34,85 @@ enum class MetadataType : int
 
 typedef bool(__stdcall* SetMetadataCallback)(const void* buffer, int32_t size, MetadataType type);
 
+// This must be kept in sync with the OutputPixelFormat enumeration in OutputPixelFormat.cs.
+enum class OutputPixelFormat : int
+{
+    Bgra32 = 0,
+    Bgr24,
+    Rgba32,
+    Gray8,
+    // One 8-bit plane per JPEG component at the native subsampling of the image.
+    PlanarYCbCr
+};
+
+typedef OutputPixelFormat(__stdcall* SelectOutputFormatCallback)(int32_t componentCount);
+
+typedef uint8_t*(__stdcall* AllocatePlaneCallback)(int32_t planeIndex, int32_t width, int32_t height, int32_t* outStride);
+
+// The progress is a percentage of the whole decode, which can span multiple passes for progressive images.
+// The scanNumber is the input scan that libjpeg is reading and rowsProduced is the output scanline.
+typedef bool(__stdcall* DecodeProgressCallback)(int32_t progress, int32_t scanNumber, uint32_t rowsProduced);
+
 struct ReadCallbacks
 {
     ReadCallback read;
     SkipBytesCallback skipBytes;
+    // Allocates an interleaved surface using the bytes per pixel of the selected output format.
     AllocateSurfaceCallback allocateSurface;
     SetMetadataCallback setMetadata;
+    // Optional, the image is decoded as Bgra32 when this is null.
+    SelectOutputFormatCallback selectOutputFormat;
+    // Required when selectOutputFormat returns PlanarYCbCr.
+    AllocatePlaneCallback allocatePlane;
+    // Optional, returning false cancels the decode.
+    DecodeProgressCallback progress;
+};
+
+// Receives a band of decoded rows in the selected interleaved output format.
+// The firstRowOffset parameter is the byte offset of the band in a tightly packed image.
+typedef bool(__stdcall* ConsumeRowsCallback)(
+    const uint8_t* rows,
+    uint32_t firstRow,
+    int32_t rowCount,
+    size_t stride,
+    uint64_t firstRowOffset);
+
+struct RowBandOptions
+{
+    // The number of rows in each band, a value of 0 uses the height of one MCU row.
+    int32_t bandHeight;
+    ConsumeRowsCallback consumeRows;
+};
+
+// This must be kept in sync with the DecodeQuality enumeration in DecodeQuality.cs.
+enum class DecodeQuality : int
+{
+    Accurate = 0,
+    // Uses the fast integer IDCT and the merged upsampler, and disables block smoothing.
+    Fast
+};
+
+// This must be kept in sync with the DecodeOptions structure in DecodeOptions.cs.
+struct DecodeOptions
+{
+    DecodeQuality quality;
+    // The maximum number of bytes that libjpeg may allocate, or 0 for no limit.
+    // The whole-image coefficient buffers of progressive and buffered image decodes are partly
+    // moved to a temporary file when they do not fit under the limit. The decode fails with
+    // DecodeStatus::OutOfMemory when the limit is smaller than the working set of the decoder.
+    int64_t maxMemoryToUse;
+    // Stops a progressive or multi-scan image after this many scans, or 0 to decode every scan.
+    // The first scan of a progressive image usually only has the DC coefficients.
+    int32_t maxScans;
+};
+
+// This must be kept in sync with the DecodeStatistics structure in DecodeStatistics.cs.
+struct DecodeStatistics
+{
+    // The largest amount of memory that libjpeg had allocated at one time, in bytes.
+    uint64_t peakMemoryUsage;
+    // The number of bytes that were moved to temporary files to stay under maxMemoryToUse.
+    uint64_t backingStoreBytes;
 };
 
 enum class DecodeStatus : int
@@ -49,7 +122,8 @@ enum class DecodeStatus : int
     OutOfMemory,
     JpegLibraryError,
     CallbackError,
-    UserCanceled
+    UserCanceled,
+    UnsupportedOutputFormat
 };
 
 enum class ChromaSubsampling : int
@@ -60,11 +134,19 @@ enum class ChromaSubsampling : int
     Subsampling400
 };
 
+// This must be kept in sync with the EncodeOptions structure in EncodeOptions.cs.
 struct EncodeOptions
 {
     int quality;
     ChromaSubsampling chromaSubsampling;
     bool progressive;
+    // Ignore chromaSubsampling and progressive and keep the smallest trial encode.
+    bool autoSelect;
+    // The minimum PSNR in dB that a trial encode must reach to be selected, 0 disables the check.
+    float autoMinimumPsnr;
+    // Write a baseline image in one pass with the standard Huffman tables, instead of
+    // buffering the image to compute optimized tables. Overrides progressive and autoSelect.
+    bool singlePass;
 };
 
 enum class EncodeStatus : int
@@ -111,14 +193,95 @@ struct MetadataParams
     size_t extendedXmpBlockCount;
 };
 
+// The statistics parameter is optional.
 extern "C" __declspec(dllexport) DecodeStatus ReadImage(
     const ReadCallbacks* callbacks,
+    const DecodeOptions* options,
+    DecodeStatistics* statistics,
+    JpegLibraryErrorInfo* errorInfo);
+
+// Decodes the image in bands of rows without allocating a surface for the whole image.
+extern "C" __declspec(dllexport) DecodeStatus ReadImageRows(
+    const ReadCallbacks* callbacks,
+    const DecodeOptions* options,
+    const RowBandOptions* rowBands,
+    DecodeStatistics* statistics,
     JpegLibraryErrorInfo* errorInfo);
 
+// This must be kept in sync with the EncodeStatistics structure in EncodeStatistics.cs.
+struct EncodeStatistics
+{
+    // The size of the image that was written, in bytes.
+    uint64_t outputSize;
+    // The size of the same image encoded with optimized Huffman tables, in bytes.
+    // This is only measured when the singlePass option is set, it is 0 otherwise.
+    uint64_t optimizedSize;
+};
+
+// The statistics parameter is optional, passing it with the singlePass option set reports the size
+// penalty of the fixed Huffman tables. The image is then encoded a second time into memory with
+// optimized Huffman tables, which takes the extra pass and coefficient buffer that singlePass avoids.
+// The statistics are not measured when the autoSelect option is used.
 extern "C" __declspec(dllexport) EncodeStatus WriteImage(
     const BitmapData* bgraImage,
     const EncodeOptions* options,
     const MetadataParams* metadata,
+    EncodeStatistics* statistics,
     JpegLibraryErrorInfo* errorInfo,
     ProgressCallback progressCallback,
     WriteCallback writeCallback);
+
+// This must be kept in sync with the RecompressOptions structure in RecompressOptions.cs.
+struct RecompressOptions
+{
+    int quality;
+    bool progressive;
+};
+
+// Lowers the quality of an existing JPEG image by requantizing its DCT coefficients,
+// only the read and skipBytes callbacks are used.
+// The EXIF, XMP and ICC profile metadata of the source image is copied to the output.
+// Trellis quantization is not supported, mozjpeg only applies it when it quantizes the
+// DCT coefficients of image samples, and the coefficients of the source image are already quantized.
+extern "C" __declspec(dllexport) EncodeStatus RecompressJpeg(
+    const ReadCallbacks* callbacks,
+    const RecompressOptions* options,
+    JpegLibraryErrorInfo* errorInfo,
+    WriteCallback writeCallback);
+
+// Keeps the entropy-coded MCU rows of the previous save so that later saves only re-encode the rows that changed.
+struct IncrementalEncoder;
+
+extern "C" __declspec(dllexport) IncrementalEncoder* CreateIncrementalEncoder();
+
+extern "C" __declspec(dllexport) void DestroyIncrementalEncoder(IncrementalEncoder* encoder);
+
+// Always writes a single pass baseline image with a restart marker after every MCU row,
+// the progressive, autoSelect and singlePass options are ignored.
+extern "C" __declspec(dllexport) EncodeStatus WriteImageIncremental(
+    IncrementalEncoder* encoder,
+    const BitmapData* bgraImage,
+    const EncodeOptions* options,
+    const MetadataParams* metadata,
+    JpegLibraryErrorInfo* errorInfo,
+    ProgressCallback progressCallback,
+    WriteCallback writeCallback);
+
+enum class TransformStatus
+{
+    Ok = 0,
+    NullParameter,
+    InvalidParameter
+};
+
+extern "C" __declspec(dllexport) TransformStatus FlipImageHorizontal(const BitmapData* image);
+
+extern "C" __declspec(dllexport) TransformStatus FlipImageVertical(const BitmapData* image);
+
+extern "C" __declspec(dllexport) TransformStatus RotateImage180(const BitmapData* image);
+
+// The destination must have the width and height of the source swapped.
+// A square image can be rotated in place by passing a null destination.
+extern "C" __declspec(dllexport) TransformStatus RotateImage90CCW(const BitmapData* source, const BitmapData* destination);
+
+extern "C" __declspec(dllexport) TransformStatus RotateImage270CCW(const BitmapData* source, const BitmapData* destination);
@@ -0,0 +1,516 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-mozjpeg, a FileType plugin for Paint.NET
+// that saves JPEG images using the mozjpeg encoder.
+//
+// Copyright (c) 2021, 2022 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#include "TrialEncoder.h"
+#include "JpegEncoderSettings.h"
+#include "JpegErrorHandler.h"
+#include "JpegMemoryDestinationManager.h"
+#include "JpegMetadataWriter.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <limits>
+#include <math.h>
+#include <mutex>
+#include <new>
+#include <system_error>
+#include <thread>
+
+namespace
+{
+    constexpr int MaxCandidateCount = 6;
+
+    struct TrialCandidate;
+
+    struct TrialEncodeState
+    {
+        const BitmapData* image = nullptr;
+        const MetadataParams* metadata = nullptr;
+        int quality = 0;
+        float minimumPsnr = 0.0f;
+        TrialCandidate* candidates = nullptr;
+        int candidateCount = 0;
+        // The index of the next candidate that a worker thread will encode.
+        std::atomic<int> nextCandidate{ 0 };
+        // The size of the smallest candidate that meets the minimum PSNR.
+        // Larger candidates stop buffering their output and skip the PSNR check when they pass it,
+        // the compression work is not saved because the optimized Huffman tables are only
+        // computed, and the output written, in jpeg_finish_compress.
+        std::atomic<size_t> bestAcceptedSize{ std::numeric_limits<size_t>::max() };
+        // Protects the finished and rejected fields and the output of the finished candidates.
+        std::mutex resultMutex;
+        uint64_t totalRows = 0;
+        std::atomic<uint64_t> rowsEncoded{ 0 };
+        std::atomic<int> finishedCount{ 0 };
+        std::atomic<bool> canceled{ false };
+        // Signaled when the progress percentage changes or a candidate finishes.
+        std::mutex progressMutex;
+        std::condition_variable progressChanged;
+    };
+
+    inline int32_t GetProgressPercentage(uint64_t rowsEncoded, uint64_t totalRows)
+    {
+        return static_cast<int32_t>(round((static_cast<double>(rowsEncoded) / static_cast<double>(totalRows)) * 100.0));
+    }
+
+    // The mutex is locked before notifying so that the notification cannot be lost
+    // between the waiting thread checking its condition and starting to wait.
+    void NotifyProgressChanged(TrialEncodeState* state)
+    {
+        {
+            std::lock_guard<std::mutex> lock(state->progressMutex);
+        }
+
+        state->progressChanged.notify_one();
+    }
+
+    struct TrialCandidate
+    {
+        ChromaSubsampling chromaSubsampling;
+        bool progressive;
+        MemoryDestination output;
+        EncodeStatus status;
+        bool finished;
+        // The candidate cannot be selected, either its output grew larger than the best accepted
+        // candidate or a better candidate finished, and its output has been freed.
+        bool rejected;
+        double psnr;
+        JpegLibraryErrorInfo errorInfo;
+    };
+
+    bool TryMeasurePsnr(const BitmapData* image, const MemoryDestination* jpeg, double* psnr)
+    {
+        if (jpeg->size > std::numeric_limits<unsigned long>::max())
+        {
+            return false;
+        }
+
+        JpegErrorContext errorContext{};
+        jpeg_decompress_struct dinfo{};
+
+        dinfo.err = jpeg_std_error(&errorContext.mgr);
+        dinfo.err->error_exit = error_exit;
+
+        if (setjmp(errorContext.setjmpBuffer))
+        {
+            // This block will be jumped to if the JPEG error_exit method is called.
+            jpeg_destroy_decompress(&dinfo);
+
+            return false;
+        }
+
+        jpeg_create_decompress(&dinfo);
+        jpeg_mem_src(&dinfo, jpeg->data, static_cast<unsigned long>(jpeg->size));
+
+        jpeg_read_header(&dinfo, true);
+
+        dinfo.out_color_space = JCS_EXT_BGRX;
+
+        jpeg_start_decompress(&dinfo);
+
+        JSAMPARRAY decodedRow = (*dinfo.mem->alloc_sarray)(
+            reinterpret_cast<j_common_ptr>(&dinfo),
+            JPOOL_IMAGE,
+            dinfo.output_width * 4,
+            1);
+
+        uint64_t sumOfSquaredErrors = 0;
+
+        while (dinfo.output_scanline < dinfo.output_height)
+        {
+            const uint8_t* src = image->scan0 + (static_cast<size_t>(dinfo.output_scanline) * image->stride);
+
+            jpeg_read_scanlines(&dinfo, decodedRow, 1);
+
+            const uint8_t* decoded = decodedRow[0];
+
+            for (JDIMENSION x = 0; x < dinfo.output_width; x++)
+            {
+                for (int i = 0; i < 3; i++)
+                {
+                    const int difference = static_cast<int>(src[i]) - static_cast<int>(decoded[i]);
+
+                    sumOfSquaredErrors += static_cast<uint64_t>(difference * difference);
+                }
+
+                src += 4;
+                decoded += 4;
+            }
+        }
+
+        jpeg_finish_decompress(&dinfo);
+        jpeg_destroy_decompress(&dinfo);
+
+        if (sumOfSquaredErrors == 0)
+        {
+            *psnr = std::numeric_limits<double>::infinity();
+        }
+        else
+        {
+            const double sampleCount = 3.0 * static_cast<double>(image->width) * static_cast<double>(image->height);
+
+            *psnr = 10.0 * log10((255.0 * 255.0 * sampleCount) / static_cast<double>(sumOfSquaredErrors));
+        }
+
+        return true;
+    }
+
+    EncodeStatus CompressCandidate(TrialEncodeState* state, TrialCandidate* candidate)
+    {
+        JpegErrorContext errorContext{};
+        jpeg_compress_struct cinfo{};
+
+        cinfo.err = jpeg_std_error(&errorContext.mgr);
+        cinfo.err->error_exit = error_exit;
+        memset(errorContext.messageBuffer, 0, _countof(errorContext.messageBuffer));
+
+        if (setjmp(errorContext.setjmpBuffer))
+        {
+            // This block will be jumped to if the JPEG error_exit method is called.
+            jpeg_destroy_compress(&cinfo);
+
+            if (candidate->output.sizeLimitExceeded)
+            {
+                // Discarding a candidate that cannot be the smallest is not an error.
+                candidate->rejected = true;
+                return EncodeStatus::Ok;
+            }
+
+            HandleErrorMessage(errorContext, &candidate->errorInfo);
+            return EncodeStatus::JpegLibraryError;
+        }
+
+        jpeg_create_compress(&cinfo);
+
+        InitializeMemoryDestinationManager(&cinfo, &candidate->output);
+
+        SetEncoderSettings(
+            &cinfo,
+            state->image,
+            state->quality,
+            candidate->chromaSubsampling,
+            candidate->progressive,
+            false);
+
+        jpeg_start_compress(&cinfo, true);
+
+        if (state->metadata != nullptr)
+        {
+            WriteMetadata(&cinfo, state->metadata);
+        }
+
+        while (cinfo.next_scanline < cinfo.image_height)
+        {
+            if (state->canceled.load(std::memory_order_relaxed))
+            {
+                jpeg_destroy_compress(&cinfo);
+
+                return EncodeStatus::UserCanceled;
+            }
+
+            uint8_t* srcRow = state->image->scan0 + (static_cast<size_t>(cinfo.next_scanline) * state->image->stride);
+
+            jpeg_write_scanlines(&cinfo, &srcRow, 1);
+
+            const uint64_t previousRows = state->rowsEncoded.fetch_add(1, std::memory_order_relaxed);
+
+            if (GetProgressPercentage(previousRows + 1, state->totalRows) != GetProgressPercentage(previousRows, state->totalRows))
+            {
+                NotifyProgressChanged(state);
+            }
+        }
+
+        jpeg_finish_compress(&cinfo);
+        jpeg_destroy_compress(&cinfo);
+
+        return EncodeStatus::Ok;
+    }
+
+    bool IsBetterCandidate(const TrialCandidate& candidate, const TrialCandidate* best, float minimumPsnr)
+    {
+        if (best == nullptr)
+        {
+            return true;
+        }
+
+        const bool candidateAccepted = candidate.psnr >= minimumPsnr;
+        const bool bestAccepted = best->psnr >= minimumPsnr;
+
+        if (candidateAccepted != bestAccepted)
+        {
+            return candidateAccepted;
+        }
+
+        return candidate.output.size < best->output.size;
+    }
+
+    // Frees the output of every finished candidate except the best one, a candidate that
+    // is not the best when it finishes can never be selected.
+    // The caller must hold the result mutex.
+    void ReleaseLosingCandidates(TrialEncodeState* state)
+    {
+        TrialCandidate* best = nullptr;
+
+        for (int i = 0; i < state->candidateCount; i++)
+        {
+            TrialCandidate& candidate = state->candidates[i];
+
+            if (candidate.finished
+                && candidate.status == EncodeStatus::Ok
+                && !candidate.rejected
+                && IsBetterCandidate(candidate, best, state->minimumPsnr))
+            {
+                best = &candidate;
+            }
+        }
+
+        for (int i = 0; i < state->candidateCount; i++)
+        {
+            TrialCandidate& candidate = state->candidates[i];
+
+            if (candidate.finished && &candidate != best)
+            {
+                candidate.rejected = true;
+                FreeMemoryDestination(&candidate.output);
+            }
+        }
+    }
+
+    void EncodeCandidate(TrialEncodeState* state, TrialCandidate* candidate)
+    {
+        if (state->canceled.load())
+        {
+            candidate->status = EncodeStatus::UserCanceled;
+        }
+        else
+        {
+            candidate->status = CompressCandidate(state, candidate);
+        }
+
+        if (candidate->status == EncodeStatus::Ok && !candidate->rejected)
+        {
+            if (!TryMeasurePsnr(state->image, &candidate->output, &candidate->psnr))
+            {
+                candidate->psnr = 0.0;
+            }
+
+            if (candidate->psnr >= state->minimumPsnr)
+            {
+                const size_t size = candidate->output.size;
+                size_t currentBest = state->bestAcceptedSize.load();
+
+                while (size < currentBest && !state->bestAcceptedSize.compare_exchange_weak(currentBest, size))
+                {
+                }
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(state->resultMutex);
+
+            candidate->finished = true;
+
+            if (candidate->status == EncodeStatus::Ok)
+            {
+                ReleaseLosingCandidates(state);
+            }
+        }
+
+        state->finishedCount.fetch_add(1);
+
+        NotifyProgressChanged(state);
+    }
+
+    void EncodeCandidates(TrialEncodeState* state)
+    {
+        int index = state->nextCandidate.fetch_add(1);
+
+        while (index < state->candidateCount)
+        {
+            EncodeCandidate(state, &state->candidates[index]);
+
+            index = state->nextCandidate.fetch_add(1);
+        }
+    }
+}
+
+EncodeStatus TrialEncodeImage(
+    const BitmapData* bgraImage,
+    const EncodeOptions* options,
+    const MetadataParams* metadata,
+    JpegLibraryErrorInfo* errorInfo,
+    ProgressCallback progressCallback,
+    WriteCallback writeCallback)
+{
+    TrialEncodeState state;
+    state.image = bgraImage;
+    state.metadata = metadata;
+    state.quality = options->quality;
+    state.minimumPsnr = options->autoMinimumPsnr;
+
+    TrialCandidate candidates[MaxCandidateCount]{};
+    int candidateCount = 0;
+
+    if (options->chromaSubsampling == ChromaSubsampling::Subsampling400)
+    {
+        // Gray-scale images only have one chroma subsampling mode.
+        candidates[candidateCount++].chromaSubsampling = ChromaSubsampling::Subsampling400;
+        candidates[candidateCount].chromaSubsampling = ChromaSubsampling::Subsampling400;
+        candidates[candidateCount++].progressive = true;
+    }
+    else
+    {
+        constexpr ChromaSubsampling subsamplingModes[] =
+        {
+            ChromaSubsampling::Subsampling420,
+            ChromaSubsampling::Subsampling422,
+            ChromaSubsampling::Subsampling444
+        };
+
+        for (ChromaSubsampling subsampling : subsamplingModes)
+        {
+            candidates[candidateCount++].chromaSubsampling = subsampling;
+            candidates[candidateCount].chromaSubsampling = subsampling;
+            candidates[candidateCount++].progressive = true;
+        }
+    }
+
+    for (int i = 0; i < candidateCount; i++)
+    {
+        candidates[i].output.sizeLimit = &state.bestAcceptedSize;
+    }
+
+    state.candidates = candidates;
+    state.candidateCount = candidateCount;
+    state.totalRows = static_cast<uint64_t>(bgraImage->height) * candidateCount;
+
+    // Each candidate that is being encoded holds a coefficient buffer for the whole image,
+    // so only one candidate is encoded per processor core.
+    const int workerCount = std::min(candidateCount, static_cast<int>(std::max(1U, std::thread::hardware_concurrency())));
+
+    std::thread threads[MaxCandidateCount];
+    int threadCount = 0;
+    EncodeStatus status = EncodeStatus::Ok;
+
+    try
+    {
+        for (; threadCount < workerCount; threadCount++)
+        {
+            threads[threadCount] = std::thread(EncodeCandidates, &state);
+        }
+    }
+    catch (const std::system_error&)
+    {
+        state.canceled.store(true);
+        status = EncodeStatus::OutOfMemory;
+    }
+    catch (const std::bad_alloc&)
+    {
+        state.canceled.store(true);
+        status = EncodeStatus::OutOfMemory;
+    }
+
+    if (status == EncodeStatus::Ok)
+    {
+        // The progress callback is called on this thread because the caller does not expect
+        // it to be invoked concurrently.
+        int32_t currentProgressPercentage = -1;
+
+        auto progressPending = [&]()
+        {
+            return progressCallback != nullptr &&
+                !state.canceled.load() &&
+                GetProgressPercentage(state.rowsEncoded.load(), state.totalRows) != currentProgressPercentage;
+        };
+
+        std::unique_lock<std::mutex> lock(state.progressMutex);
+
+        while (state.finishedCount.load() < candidateCount)
+        {
+            if (progressPending())
+            {
+                currentProgressPercentage = GetProgressPercentage(state.rowsEncoded.load(), state.totalRows);
+
+                // The candidate threads are not blocked while the callback runs.
+                lock.unlock();
+                const bool continueEncoding = progressCallback(currentProgressPercentage);
+                lock.lock();
+
+                if (!continueEncoding)
+                {
+                    state.canceled.store(true);
+                }
+            }
+
+            state.progressChanged.wait(lock, [&]()
+            {
+                return state.finishedCount.load() >= candidateCount || progressPending();
+            });
+        }
+    }
+
+    for (int i = 0; i < threadCount; i++)
+    {
+        threads[i].join();
+    }
+
+    if (status == EncodeStatus::Ok)
+    {
+        if (state.canceled.load())
+        {
+            status = EncodeStatus::UserCanceled;
+        }
+        else
+        {
+            const TrialCandidate* best = nullptr;
+            const TrialCandidate* firstFailure = nullptr;
+
+            for (int i = 0; i < candidateCount; i++)
+            {
+                const TrialCandidate& candidate = candidates[i];
+
+                if (candidate.status != EncodeStatus::Ok)
+                {
+                    if (firstFailure == nullptr)
+                    {
+                        firstFailure = &candidate;
+                    }
+                }
+                else if (!candidate.rejected && IsBetterCandidate(candidate, best, state.minimumPsnr))
+                {
+                    best = &candidate;
+                }
+            }
+
+            if (best != nullptr)
+            {
+                if (!writeCallback(best->output.data, best->output.size))
+                {
+                    strcpy_s(errorInfo->errorMessage, "File write error.");
+                    status = EncodeStatus::JpegLibraryError;
+                }
+            }
+            else if (firstFailure != nullptr)
+            {
+                *errorInfo = firstFailure->errorInfo;
+                status = firstFailure->status;
+            }
+        }
+    }
+
+    for (int i = 0; i < candidateCount; i++)
+    {
+        FreeMemoryDestination(&candidates[i].output);
+    }
+
+    return status;
+}
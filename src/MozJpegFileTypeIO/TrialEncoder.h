@@ -0,0 +1,28 @@
+////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-mozjpeg, a FileType plugin for Paint.NET
+// that saves JPEG images using the mozjpeg encoder.
+//
+// Copyright (c) 2021, 2022 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MozJpegFileTypeIO.h"
+
+// Encodes the baseline and progressive variants of each chroma subsampling mode in parallel,
+// and writes the smallest result that meets the minimum PSNR in the encode options.
+// At most one candidate per processor core is encoded at a time, and each one holds a coefficient
+// buffer for the whole image while it is encoded. Every candidate is fully compressed, a candidate
+// that is larger than the best accepted one only skips buffering its output and the PSNR check.
+EncodeStatus TrialEncodeImage(
+    const BitmapData* bgraImage,
+    const EncodeOptions* options,
+    const MetadataParams* metadata,
+    JpegLibraryErrorInfo* errorInfo,
+    ProgressCallback progressCallback,
+    WriteCallback writeCallback);
@@ -21,18 +21,46 @@ namespace MozJpegFileType
 {
     internal static class MozJpegNative
     {
-        public static unsafe MozJpegLoadState Load(Stream input, IArrayPoolService arrayPool)
+        public static unsafe MozJpegLoadState Load(
+            Stream input,
+            DecodeQuality decodeQuality,
+            ProgressEventHandler progressEventHandler,
+            IArrayPoolService arrayPool)
         {
             MozJpegLoadState loadState = new MozJpegLoadState(arrayPool);
 
+            DecodeOptions decodeOptions = new DecodeOptions
+            {
+                quality = decodeQuality
+            };
+
             using (MozJpegStreamIO streamIO = new MozJpegStreamIO(input, arrayPool))
             {
+                DecodeProgressCallback progressCallback = null;
+
+                if (progressEventHandler != null)
+                {
+                    progressCallback = new DecodeProgressCallback(delegate (int progress, int scanNumber, uint rowsProduced)
+                    {
+                        try
+                        {
+                            progressEventHandler.Invoke(null, new ProgressEventArgs(progress, true));
+                            return true;
+                        }
+                        catch (OperationCanceledException)
+                        {
+                            return false;
+                        }
+                    });
+                }
+
                 ReadCallbacks callbacks = new ReadCallbacks
                 {
                     read = streamIO.Read,
                     skipBytes = streamIO.SkipBytes,
                     allocateSurface = loadState.AllocateSurface,
-                    setIccProfile = loadState.SetMetadata
+                    setIccProfile = loadState.SetMetadata,
+                    progress = progressCallback
                 };
 
                 JpegLibraryErrorInfo errorInfo = new JpegLibraryErrorInfo();
@@ -40,15 +68,15 @@ namespace MozJpegFileType
 
                 if (RuntimeInformation.ProcessArchitecture == Architecture.X64)
                 {
-                    status = MozJpeg_X64.ReadImage(callbacks, ref errorInfo);
+                    status = MozJpeg_X64.ReadImage(callbacks, ref decodeOptions, null, ref errorInfo);
                 }
                 else if (RuntimeInformation.ProcessArchitecture == Architecture.Arm64)
                 {
-                    status = MozJpeg_Arm64.ReadImage(callbacks, ref errorInfo);
+                    status = MozJpeg_Arm64.ReadImage(callbacks, ref decodeOptions, null, ref errorInfo);
                 }
                 else if (RuntimeInformation.ProcessArchitecture == Architecture.X86)
                 {
-                    status = MozJpeg_X86.ReadImage(callbacks, ref errorInfo);
+                    status = MozJpeg_X86.ReadImage(callbacks, ref decodeOptions, null, ref errorInfo);
                 }
                 else
                 {
@@ -100,6 +128,8 @@ namespace MozJpegFileType
                                 throw new OutOfMemoryException();
                             case DecodeStatus.UserCanceled:
                                 throw new OperationCanceledException();
+                            case DecodeStatus.UnsupportedOutputFormat:
+                                throw new FormatException("The requested output format is not supported for this image.");
                             default:
                                 throw new FormatException("An unknown error occurred when reading the image.");
                         }
@@ -110,12 +140,226 @@ namespace MozJpegFileType
             return loadState;
         }
 
-        public static unsafe void Save(
+        public static IncrementalEncoderHandle CreateIncrementalEncoder()
+        {
+            if (RuntimeInformation.ProcessArchitecture == Architecture.X64)
+            {
+                return MozJpeg_X64.CreateIncrementalEncoder();
+            }
+            else if (RuntimeInformation.ProcessArchitecture == Architecture.Arm64)
+            {
+                return MozJpeg_Arm64.CreateIncrementalEncoder();
+            }
+            else if (RuntimeInformation.ProcessArchitecture == Architecture.X86)
+            {
+                return MozJpeg_X86.CreateIncrementalEncoder();
+            }
+            else
+            {
+                throw new PlatformNotSupportedException();
+            }
+        }
+
+        public static void Save(
+            Surface input,
+            Stream output,
+            EncodeOptions encodeOptions,
+            MetadataParams metadata,
+            ProgressEventHandler progressEventHandler,
+            IArrayPoolService arrayPool)
+        {
+            Save(input, output, null, encodeOptions, metadata, progressEventHandler, arrayPool);
+        }
+
+        /// <summary>
+        /// Saves the image as a baseline JPEG, re-encoding only the MCU rows that changed since
+        /// the previous save that used <paramref name="encoder"/>.
+        /// </summary>
+        public static void SaveIncremental(
+            IncrementalEncoderHandle encoder,
+            Surface input,
+            Stream output,
+            EncodeOptions encodeOptions,
+            MetadataParams metadata,
+            ProgressEventHandler progressEventHandler,
+            IArrayPoolService arrayPool)
+        {
+            if (encoder is null)
+            {
+                throw new ArgumentNullException(nameof(encoder));
+            }
+
+            Save(input, output, encoder, encodeOptions, metadata, progressEventHandler, arrayPool);
+        }
+
+        public static void FlipHorizontal(Surface surface)
+        {
+            BitmapData bitmap = CreateBitmapData(surface);
+            TransformStatus status;
+
+            if (RuntimeInformation.ProcessArchitecture == Architecture.X64)
+            {
+                status = MozJpeg_X64.FlipImageHorizontal(ref bitmap);
+            }
+            else if (RuntimeInformation.ProcessArchitecture == Architecture.Arm64)
+            {
+                status = MozJpeg_Arm64.FlipImageHorizontal(ref bitmap);
+            }
+            else if (RuntimeInformation.ProcessArchitecture == Architecture.X86)
+            {
+                status = MozJpeg_X86.FlipImageHorizontal(ref bitmap);
+            }
+            else
+            {
+                throw new PlatformNotSupportedException();
+            }
+
+            ThrowOnTransformError(status);
+        }
+
+        public static void FlipVertical(Surface surface)
+        {
+            BitmapData bitmap = CreateBitmapData(surface);
+            TransformStatus status;
+
+            if (RuntimeInformation.ProcessArchitecture == Architecture.X64)
+            {
+                status = MozJpeg_X64.FlipImageVertical(ref bitmap);
+            }
+            else if (RuntimeInformation.ProcessArchitecture == Architecture.Arm64)
+            {
+                status = MozJpeg_Arm64.FlipImageVertical(ref bitmap);
+            }
+            else if (RuntimeInformation.ProcessArchitecture == Architecture.X86)
+            {
+                status = MozJpeg_X86.FlipImageVertical(ref bitmap);
+            }
+            else
+            {
+                throw new PlatformNotSupportedException();
+            }
+
+            ThrowOnTransformError(status);
+        }
+
+        public static void Rotate180(Surface surface)
+        {
+            BitmapData bitmap = CreateBitmapData(surface);
+            TransformStatus status;
+
+            if (RuntimeInformation.ProcessArchitecture == Architecture.X64)
+            {
+                status = MozJpeg_X64.RotateImage180(ref bitmap);
+            }
+            else if (RuntimeInformation.ProcessArchitecture == Architecture.Arm64)
+            {
+                status = MozJpeg_Arm64.RotateImage180(ref bitmap);
+            }
+            else if (RuntimeInformation.ProcessArchitecture == Architecture.X86)
+            {
+                status = MozJpeg_X86.RotateImage180(ref bitmap);
+            }
+            else
+            {
+                throw new PlatformNotSupportedException();
+            }
+
+            ThrowOnTransformError(status);
+        }
+
+        /// <summary>
+        /// Rotates the source image into the destination, or rotates a square source image in place
+        /// when <paramref name="destination"/> is <see langword="null"/>.
+        /// </summary>
+        public static unsafe void Rotate90CCW(Surface source, Surface destination)
+        {
+            BitmapData sourceBitmap = CreateBitmapData(source);
+            BitmapData destinationBitmap = destination != null ? CreateBitmapData(destination) : default;
+            BitmapData* destinationPtr = destination != null ? &destinationBitmap : null;
+            TransformStatus status;
+
+            if (RuntimeInformation.ProcessArchitecture == Architecture.X64)
+            {
+                status = MozJpeg_X64.RotateImage90CCW(ref sourceBitmap, destinationPtr);
+            }
+            else if (RuntimeInformation.ProcessArchitecture == Architecture.Arm64)
+            {
+                status = MozJpeg_Arm64.RotateImage90CCW(ref sourceBitmap, destinationPtr);
+            }
+            else if (RuntimeInformation.ProcessArchitecture == Architecture.X86)
+            {
+                status = MozJpeg_X86.RotateImage90CCW(ref sourceBitmap, destinationPtr);
+            }
+            else
+            {
+                throw new PlatformNotSupportedException();
+            }
+
+            ThrowOnTransformError(status);
+        }
+
+        /// <summary>
+        /// Rotates the source image into the destination, or rotates a square source image in place
+        /// when <paramref name="destination"/> is <see langword="null"/>.
+        /// </summary>
+        public static unsafe void Rotate270CCW(Surface source, Surface destination)
+        {
+            BitmapData sourceBitmap = CreateBitmapData(source);
+            BitmapData destinationBitmap = destination != null ? CreateBitmapData(destination) : default;
+            BitmapData* destinationPtr = destination != null ? &destinationBitmap : null;
+            TransformStatus status;
+
+            if (RuntimeInformation.ProcessArchitecture == Architecture.X64)
+            {
+                status = MozJpeg_X64.RotateImage270CCW(ref sourceBitmap, destinationPtr);
+            }
+            else if (RuntimeInformation.ProcessArchitecture == Architecture.Arm64)
+            {
+                status = MozJpeg_Arm64.RotateImage270CCW(ref sourceBitmap, destinationPtr);
+            }
+            else if (RuntimeInformation.ProcessArchitecture == Architecture.X86)
+            {
+                status = MozJpeg_X86.RotateImage270CCW(ref sourceBitmap, destinationPtr);
+            }
+            else
+            {
+                throw new PlatformNotSupportedException();
+            }
+
+            ThrowOnTransformError(status);
+        }
+
+        private static unsafe BitmapData CreateBitmapData(Surface surface)
+        {
+            return new BitmapData
+            {
+                scan0 = (byte*)surface.Scan0.VoidStar,
+                width = (uint)surface.Width,
+                height = (uint)surface.Height,
+                stride = (uint)surface.Stride
+            };
+        }
+
+        private static void ThrowOnTransformError(TransformStatus status)
+        {
+            switch (status)
+            {
+                case TransformStatus.Ok:
+                    break;
+                case TransformStatus.NullParameter:
+                    throw new ArgumentException("A required image transform parameter was null.");
+                case TransformStatus.InvalidParameter:
+                    throw new ArgumentException("The image dimensions are not valid for the transform.");
+                default:
+                    throw new InvalidOperationException("An unknown error occurred when transforming the image.");
+            }
+        }
+
+        private static unsafe void Save(
             Surface input,
             Stream output,
-            int quality,
-            ChromaSubsampling chromaSubsampling,
-            bool progressive,
+            IncrementalEncoderHandle incrementalEncoder,
+            EncodeOptions encodeOptions,
             MetadataParams metadata,
             ProgressEventHandler progressEventHandler,
             IArrayPoolService arrayPool)
@@ -128,13 +372,6 @@ namespace MozJpegFileType
                 stride = (uint)input.Stride
             };
 
-            EncodeOptions encodeOptions = new EncodeOptions
-            {
-                quality = quality,
-                chromaSubsampling = chromaSubsampling,
-                progressive = progressive
-            };
-
             using (MozJpegStreamIO streamIO = new MozJpegStreamIO(output, arrayPool))
             {
                 WriteCallback writeCallback = streamIO.Write;
@@ -162,30 +399,72 @@ namespace MozJpegFileType
 
                 if (RuntimeInformation.ProcessArchitecture == Architecture.X64)
                 {
-                    status = MozJpeg_X64.WriteImage(ref bitmap,
-                                                    ref encodeOptions,
-                                                    metadata,
-                                                    ref errorInfo,
-                                                    progressCallback,
-                                                    writeCallback);
+                    if (incrementalEncoder != null)
+                    {
+                        status = MozJpeg_X64.WriteImageIncremental(incrementalEncoder,
+                                                                   ref bitmap,
+                                                                   ref encodeOptions,
+                                                                   metadata,
+                                                                   ref errorInfo,
+                                                                   progressCallback,
+                                                                   writeCallback);
+                    }
+                    else
+                    {
+                        status = MozJpeg_X64.WriteImage(ref bitmap,
+                                                        ref encodeOptions,
+                                                        metadata,
+                                                        null,
+                                                        ref errorInfo,
+                                                        progressCallback,
+                                                        writeCallback);
+                    }
                 }
                 else if (RuntimeInformation.ProcessArchitecture == Architecture.Arm64)
                 {
-                    status = MozJpeg_Arm64.WriteImage(ref bitmap,
-                                                      ref encodeOptions,
-                                                      metadata,
-                                                      ref errorInfo,
-                                                      progressCallback,
-                                                      writeCallback);
+                    if (incrementalEncoder != null)
+                    {
+                        status = MozJpeg_Arm64.WriteImageIncremental(incrementalEncoder,
+                                                                     ref bitmap,
+                                                                     ref encodeOptions,
+                                                                     metadata,
+                                                                     ref errorInfo,
+                                                                     progressCallback,
+                                                                     writeCallback);
+                    }
+                    else
+                    {
+                        status = MozJpeg_Arm64.WriteImage(ref bitmap,
+                                                          ref encodeOptions,
+                                                          metadata,
+                                                          null,
+                                                          ref errorInfo,
+                                                          progressCallback,
+                                                          writeCallback);
+                    }
                 }
                 else if (RuntimeInformation.ProcessArchitecture == Architecture.X86)
                 {
-                    status = MozJpeg_X86.WriteImage(ref bitmap,
-                                                    ref encodeOptions,
-                                                    metadata,
-                                                    ref errorInfo,
-                                                    progressCallback,
-                                                    writeCallback);
+                    if (incrementalEncoder != null)
+                    {
+                        status = MozJpeg_X86.WriteImageIncremental(incrementalEncoder,
+                                                                   ref bitmap,
+                                                                   ref encodeOptions,
+                                                                   metadata,
+                                                                   ref errorInfo,
+                                                                   progressCallback,
+                                                                   writeCallback);
+                    }
+                    else
+                    {
+                        status = MozJpeg_X86.WriteImage(ref bitmap,
+                                                        ref encodeOptions,
+                                                        metadata,
+                                                        null,
+                                                        ref errorInfo,
+                                                        progressCallback,
+                                                        writeCallback);
+                    }
                 }
                 else
                 {
@@ -0,0 +1,93 @@
+﻿////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-mozjpeg, a FileType plugin for Paint.NET
+// that saves JPEG images using the mozjpeg encoder.
+//
+// Copyright (c) 2021, 2022 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+
+using MozJpegFileType.Interop;
+
+namespace MozJpegFileType.Tests
+{
+    /// <summary>
+    /// Checks that the automatic encoding mode keeps the smallest trial encode.
+    /// </summary>
+    internal static class AutoSelectTests
+    {
+        private const int Quality = 85;
+
+        public static void Run()
+        {
+            TestImage source = TestImage.CreatePhotoLike(320, 240);
+
+            KeepsSmallestCandidate(source);
+            MinimumPsnrRejectsSmallerCandidates(source);
+        }
+
+        private static void KeepsSmallestCandidate(TestImage source)
+        {
+            byte[] jpeg = NativeCodec.Encode(
+                source,
+                new EncodeOptions { quality = Quality, autoSelect = true, autoMinimumPsnr = 0.0f });
+
+            TestResults.Check(nameof(KeepsSmallestCandidate), jpeg.Length == GetSmallestCandidateSize(source, 0.0));
+        }
+
+        private static void MinimumPsnrRejectsSmallerCandidates(TestImage source)
+        {
+            // A floor between the PSNR of the 4:2:0 and 4:4:4 encodes leaves only the 4:4:4 candidates.
+            double minimumPsnr = GetPsnr(source, ChromaSubsampling.Subsampling444, false) - 0.01;
+
+            byte[] jpeg = NativeCodec.Encode(
+                source,
+                new EncodeOptions { quality = Quality, autoSelect = true, autoMinimumPsnr = (float)minimumPsnr });
+
+            bool passed = GetPsnr(source, ChromaSubsampling.Subsampling420, false) < minimumPsnr
+                          && jpeg.Length == GetSmallestCandidateSize(source, minimumPsnr);
+
+            TestResults.Check(nameof(MinimumPsnrRejectsSmallerCandidates), passed);
+        }
+
+        private static int GetSmallestCandidateSize(TestImage source, double minimumPsnr)
+        {
+            int smallestSize = int.MaxValue;
+
+            foreach (ChromaSubsampling chromaSubsampling in new[] { ChromaSubsampling.Subsampling420, ChromaSubsampling.Subsampling422, ChromaSubsampling.Subsampling444 })
+            {
+                foreach (bool progressive in new[] { false, true })
+                {
+                    byte[] jpeg = Encode(source, chromaSubsampling, progressive);
+
+                    NativeCodec.Decode(jpeg, new DecodeOptions(), out TestImage decoded);
+
+                    if (TestImage.ComputePsnr(source, decoded) >= minimumPsnr && jpeg.Length < smallestSize)
+                    {
+                        smallestSize = jpeg.Length;
+                    }
+                }
+            }
+
+            return smallestSize;
+        }
+
+        private static double GetPsnr(TestImage source, ChromaSubsampling chromaSubsampling, bool progressive)
+        {
+            NativeCodec.Decode(Encode(source, chromaSubsampling, progressive), new DecodeOptions(), out TestImage decoded);
+
+            return TestImage.ComputePsnr(source, decoded);
+        }
+
+        private static byte[] Encode(TestImage source, ChromaSubsampling chromaSubsampling, bool progressive)
+        {
+            return NativeCodec.Encode(
+                source,
+                new EncodeOptions { quality = Quality, chromaSubsampling = chromaSubsampling, progressive = progressive });
+        }
+    }
+}
@@ -0,0 +1,78 @@
+﻿////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-mozjpeg, a FileType plugin for Paint.NET
+// that saves JPEG images using the mozjpeg encoder.
+//
+// Copyright (c) 2021, 2022 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+
+using MozJpegFileType.Interop;
+using System;
+using System.Diagnostics;
+
+namespace MozJpegFileType.Tests
+{
+    /// <summary>
+    /// Reports the decode throughput of each <see cref="DecodeQuality"/> tier.
+    /// </summary>
+    /// <remarks>
+    /// This is not run with the tests, pass --benchmark on the command line and use a Release build.
+    /// </remarks>
+    internal static class DecodeBenchmark
+    {
+        private const int ImageWidth = 4000;
+        private const int ImageHeight = 3000;
+        private const int WarmupIterations = 2;
+        private const int MeasuredIterations = 10;
+
+        public static void Run()
+        {
+            TestImage source = TestImage.CreatePhotoLike(ImageWidth, ImageHeight);
+
+            foreach (ChromaSubsampling chromaSubsampling in new ChromaSubsampling[] { ChromaSubsampling.Subsampling420, ChromaSubsampling.Subsampling444 })
+            {
+                byte[] jpeg = NativeCodec.Encode(source, new EncodeOptions { quality = 90, chromaSubsampling = chromaSubsampling });
+
+                foreach (DecodeQuality quality in new DecodeQuality[] { DecodeQuality.Accurate, DecodeQuality.Fast })
+                {
+                    double megapixelsPerSecond = MeasureDecode(jpeg, quality);
+
+                    Console.WriteLine($"{chromaSubsampling}, {quality}: {megapixelsPerSecond:F1} MP/s");
+                }
+            }
+        }
+
+        private static double MeasureDecode(byte[] jpeg, DecodeQuality quality)
+        {
+            DecodeOptions options = new DecodeOptions { quality = quality };
+
+            for (int i = 0; i < WarmupIterations; i++)
+            {
+                NativeCodec.Decode(jpeg, options, out _);
+            }
+
+            Stopwatch stopwatch = Stopwatch.StartNew();
+
+            for (int i = 0; i < MeasuredIterations; i++)
+            {
+                DecodeStatus status = NativeCodec.Decode(jpeg, options, out _);
+
+                if (status != DecodeStatus.Ok)
+                {
+                    throw new InvalidOperationException($"ReadImage failed with {status}.");
+                }
+            }
+
+            stopwatch.Stop();
+
+            double megapixels = (double)ImageWidth * ImageHeight * MeasuredIterations / 1000000.0;
+
+            return megapixels / stopwatch.Elapsed.TotalSeconds;
+        }
+    }
+}
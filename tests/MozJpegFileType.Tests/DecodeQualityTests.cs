@@ -0,0 +1,66 @@
+﻿////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-mozjpeg, a FileType plugin for Paint.NET
+// that saves JPEG images using the mozjpeg encoder.
+//
+// Copyright (c) 2021, 2022 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+
+using MozJpegFileType.Interop;
+
+namespace MozJpegFileType.Tests
+{
+    /// <summary>
+    /// Checks that the fast decode tier stays close to the accurate decoder.
+    /// </summary>
+    internal static class DecodeQualityTests
+    {
+        // The fast integer IDCT and merged upsampler may lose a little precision compared
+        // to the accurate decoder, but the loss must stay below this bound.
+        private const double MaxFastPsnrLoss = 1.0;
+        private const double MinimumFastPsnr = 30.0;
+        // The PSNR between the fast and accurate decodes of the same file.
+        private const double MinimumFastToAccuratePsnr = 35.0;
+
+        public static void Run()
+        {
+            TestImage source = TestImage.CreatePhotoLike(256, 192);
+
+            FastDecodeMeetsPsnrFloor(source, ChromaSubsampling.Subsampling420);
+            FastDecodeMeetsPsnrFloor(source, ChromaSubsampling.Subsampling444);
+        }
+
+        private static void FastDecodeMeetsPsnrFloor(TestImage source, ChromaSubsampling chromaSubsampling)
+        {
+            byte[] jpeg = NativeCodec.Encode(source, new EncodeOptions { quality = 90, chromaSubsampling = chromaSubsampling });
+
+            DecodeStatus accurateStatus = NativeCodec.Decode(
+                jpeg,
+                new DecodeOptions { quality = DecodeQuality.Accurate },
+                out TestImage accurate);
+            DecodeStatus fastStatus = NativeCodec.Decode(
+                jpeg,
+                new DecodeOptions { quality = DecodeQuality.Fast },
+                out TestImage fast);
+
+            bool passed = false;
+
+            if (accurateStatus == DecodeStatus.Ok && fastStatus == DecodeStatus.Ok)
+            {
+                double accuratePsnr = TestImage.ComputePsnr(source, accurate);
+                double fastPsnr = TestImage.ComputePsnr(source, fast);
+
+                passed = fastPsnr >= MinimumFastPsnr
+                         && fastPsnr >= accuratePsnr - MaxFastPsnrLoss
+                         && TestImage.ComputePsnr(accurate, fast) >= MinimumFastToAccuratePsnr;
+            }
+
+            TestResults.Check($"{nameof(FastDecodeMeetsPsnrFloor)}({chromaSubsampling})", passed);
+        }
+    }
+}
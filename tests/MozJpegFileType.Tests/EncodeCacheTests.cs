@@ -0,0 +1,182 @@
+﻿////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-mozjpeg, a FileType plugin for Paint.NET
+// that saves JPEG images using the mozjpeg encoder.
+//
+// Copyright (c) 2021, 2022 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+using MozJpegFileType.Caching;
+using System;
+using System.Collections.Generic;
+using System.IO;
+
+namespace MozJpegFileType.Tests
+{
+    /// <summary>
+    /// Checks for the <see cref="ContentHasher"/> and <see cref="EncodeCacheWriteStream"/> classes.
+    /// </summary>
+    /// <remarks>
+    /// The hasher uses an AVX2 path when it is supported, run the tests
+    /// again with DOTNET_EnableAVX2=0 to check the scalar path.
+    /// </remarks>
+    internal static class EncodeCacheTests
+    {
+        private const int StripeLength = 32;
+        private const int StripesPerBlock = 32;
+        private const string ExpectedKnownKey = "dfe9104670cd2b3b9e18641c15c74bba";
+
+        public static void Run()
+        {
+            StripeSwapChangesKey();
+            StripeSwapAcrossBlocksChangesKey();
+            SingleBitChangeChangesKey();
+            KeyDoesNotDependOnAppendChunking();
+            KnownKeyIsStable();
+            WriteStreamCapturesOutput();
+            WriteStreamStopsCapturingLargeOutput();
+        }
+
+        private static void StripeSwapChangesKey()
+        {
+            byte[] data = CreateTestData(StripeLength * StripesPerBlock);
+            EncodeCacheKey originalKey = Hash(data);
+            HashSet<EncodeCacheKey> keys = new HashSet<EncodeCacheKey> { originalKey };
+            bool allKeysUnique = true;
+
+            for (int first = 0; first < StripesPerBlock; first++)
+            {
+                for (int second = first + 1; second < StripesPerBlock; second++)
+                {
+                    byte[] swapped = (byte[])data.Clone();
+                    SwapStripes(swapped, first, second);
+
+                    allKeysUnique &= keys.Add(Hash(swapped));
+                }
+            }
+
+            TestResults.Check(nameof(StripeSwapChangesKey), allKeysUnique);
+        }
+
+        private static void StripeSwapAcrossBlocksChangesKey()
+        {
+            byte[] data = CreateTestData(StripeLength * StripesPerBlock * 3);
+            byte[] swapped = (byte[])data.Clone();
+
+            SwapStripes(swapped, 5, StripesPerBlock + 5);
+
+            TestResults.Check(nameof(StripeSwapAcrossBlocksChangesKey), !Hash(data).Equals(Hash(swapped)));
+        }
+
+        private static void SingleBitChangeChangesKey()
+        {
+            byte[] data = CreateTestData((StripeLength * StripesPerBlock * 2) + 17);
+            EncodeCacheKey originalKey = Hash(data);
+            bool allKeysChanged = true;
+
+            for (int i = 0; i < data.Length; i += 7)
+            {
+                data[i] ^= 0x10;
+                allKeysChanged &= !Hash(data).Equals(originalKey);
+                data[i] ^= 0x10;
+            }
+
+            TestResults.Check(nameof(SingleBitChangeChangesKey), allKeysChanged);
+        }
+
+        private static void KeyDoesNotDependOnAppendChunking()
+        {
+            byte[] data = CreateTestData((StripeLength * StripesPerBlock * 2) + 45);
+            EncodeCacheKey expectedKey = Hash(data);
+            bool allKeysEqual = true;
+
+            foreach (int chunkSize in new int[] { 1, 3, 31, 32, 33, 1000 })
+            {
+                ContentHasher hasher = new ContentHasher();
+
+                for (int offset = 0; offset < data.Length; offset += chunkSize)
+                {
+                    hasher.Append(data.AsSpan(offset, Math.Min(chunkSize, data.Length - offset)));
+                }
+
+                allKeysEqual &= hasher.GetHash().Equals(expectedKey);
+            }
+
+            TestResults.Check(nameof(KeyDoesNotDependOnAppendChunking), allKeysEqual);
+        }
+
+        private static void KnownKeyIsStable()
+        {
+            // The keys are used as the names of the disk cache files, so the AVX2 and
+            // scalar paths must produce the same result on every run.
+            EncodeCacheKey key = Hash(CreateTestData((StripeLength * StripesPerBlock * 2) + 45));
+
+            TestResults.Check(nameof(KnownKeyIsStable), key.ToString() == ExpectedKnownKey);
+        }
+
+        private static void WriteStreamCapturesOutput()
+        {
+            byte[] data = CreateTestData(200 * 1024);
+
+            using (MemoryStream output = new MemoryStream())
+            using (EncodeCacheWriteStream stream = new EncodeCacheWriteStream(output, data.Length))
+            {
+                for (int offset = 0; offset < data.Length; offset += 4096)
+                {
+                    stream.Write(data, offset, Math.Min(4096, data.Length - offset));
+                }
+
+                bool passed = stream.TryGetCapturedData(out ArraySegment<byte> capturedData)
+                              && capturedData.AsSpan().SequenceEqual(data)
+                              && output.ToArray().AsSpan().SequenceEqual(data);
+
+                TestResults.Check(nameof(WriteStreamCapturesOutput), passed);
+            }
+        }
+
+        private static void WriteStreamStopsCapturingLargeOutput()
+        {
+            byte[] data = CreateTestData(200 * 1024);
+
+            using (MemoryStream output = new MemoryStream())
+            using (EncodeCacheWriteStream stream = new EncodeCacheWriteStream(output, data.Length - 1))
+            {
+                stream.Write(data, 0, data.Length);
+
+                bool passed = !stream.TryGetCapturedData(out _) && output.ToArray().AsSpan().SequenceEqual(data);
+
+                TestResults.Check(nameof(WriteStreamStopsCapturingLargeOutput), passed);
+            }
+        }
+
+        private static byte[] CreateTestData(int length)
+        {
+            byte[] data = new byte[length];
+            new Random(1234).NextBytes(data);
+
+            return data;
+        }
+
+        private static EncodeCacheKey Hash(byte[] data)
+        {
+            ContentHasher hasher = new ContentHasher();
+            hasher.Append(data);
+
+            return hasher.GetHash();
+        }
+
+        private static void SwapStripes(byte[] data, int first, int second)
+        {
+            Span<byte> firstStripe = data.AsSpan(first * StripeLength, StripeLength);
+            Span<byte> secondStripe = data.AsSpan(second * StripeLength, StripeLength);
+            byte[] temp = firstStripe.ToArray();
+
+            secondStripe.CopyTo(firstStripe);
+            temp.CopyTo(secondStripe);
+        }
+    }
+}
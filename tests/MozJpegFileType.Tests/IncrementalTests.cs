@@ -0,0 +1,97 @@
+﻿////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-mozjpeg, a FileType plugin for Paint.NET
+// that saves JPEG images using the mozjpeg encoder.
+//
+// Copyright (c) 2021, 2022 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+
+using MozJpegFileType.Interop;
+using System;
+
+namespace MozJpegFileType.Tests
+{
+    /// <summary>
+    /// Checks that the incremental encoder splices the changed bands into the previous save correctly.
+    /// </summary>
+    internal static class IncrementalTests
+    {
+        // The image height is not a multiple of the 16 pixel MCU row height, so the last band is partial.
+        private const int ImageWidth = 96;
+        private const int ImageHeight = 86;
+
+        public static void Run()
+        {
+            EditedBandsMatchFullEncode(ChromaSubsampling.Subsampling420, 20, 8);
+            EditedBandsMatchFullEncode(ChromaSubsampling.Subsampling420, 40, 20);
+            EditedBandsMatchFullEncode(ChromaSubsampling.Subsampling444, 80, 6);
+            UnchangedImageMatchesPreviousSave();
+        }
+
+        private static void EditedBandsMatchFullEncode(ChromaSubsampling chromaSubsampling, int firstEditedRow, int editedRowCount)
+        {
+            EncodeOptions options = new EncodeOptions { quality = 85, chromaSubsampling = chromaSubsampling };
+            TestImage original = TestImage.CreatePhotoLike(ImageWidth, ImageHeight);
+            TestImage edited = original.Clone();
+
+            for (int y = firstEditedRow; y < firstEditedRow + editedRowCount; y++)
+            {
+                Span<byte> row = edited.Pixels.AsSpan(y * edited.Stride, ImageWidth * 4);
+
+                for (int x = 0; x < row.Length; x += 4)
+                {
+                    row[x] = (byte)(255 - row[x]);
+                    row[x + 2] = (byte)(x * 3 / 4);
+                }
+            }
+
+            byte[] previous;
+            byte[] spliced;
+            byte[] fullEncode;
+
+            using (IncrementalEncoderHandle encoder = MozJpeg_X64.CreateIncrementalEncoder())
+            {
+                previous = NativeCodec.EncodeIncremental(encoder, original, options);
+                spliced = NativeCodec.EncodeIncremental(encoder, edited, options);
+            }
+
+            using (IncrementalEncoderHandle encoder = MozJpeg_X64.CreateIncrementalEncoder())
+            {
+                fullEncode = NativeCodec.EncodeIncremental(encoder, edited, options);
+            }
+
+            DecodeStatus splicedStatus = NativeCodec.Decode(spliced, new DecodeOptions(), out TestImage splicedImage);
+            DecodeStatus fullStatus = NativeCodec.Decode(fullEncode, new DecodeOptions(), out TestImage fullImage);
+
+            bool passed = splicedStatus == DecodeStatus.Ok
+                          && fullStatus == DecodeStatus.Ok
+                          && !spliced.AsSpan().SequenceEqual(previous)
+                          && splicedImage.Pixels.AsSpan().SequenceEqual(fullImage.Pixels)
+                          && spliced.AsSpan().SequenceEqual(fullEncode);
+
+            TestResults.Check($"{nameof(EditedBandsMatchFullEncode)}({chromaSubsampling}, rows {firstEditedRow}-{firstEditedRow + editedRowCount - 1})", passed);
+        }
+
+        private static void UnchangedImageMatchesPreviousSave()
+        {
+            EncodeOptions options = new EncodeOptions { quality = 85, chromaSubsampling = ChromaSubsampling.Subsampling420 };
+            TestImage image = TestImage.CreatePhotoLike(ImageWidth, ImageHeight);
+
+            byte[] first;
+            byte[] second;
+
+            using (IncrementalEncoderHandle encoder = MozJpeg_X64.CreateIncrementalEncoder())
+            {
+                first = NativeCodec.EncodeIncremental(encoder, image, options);
+                second = NativeCodec.EncodeIncremental(encoder, image, options);
+            }
+
+            TestResults.Check(nameof(UnchangedImageMatchesPreviousSave), second.AsSpan().SequenceEqual(first));
+        }
+    }
+}
@@ -0,0 +1,133 @@
+﻿////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-mozjpeg, a FileType plugin for Paint.NET
+// that saves JPEG images using the mozjpeg encoder.
+//
+// Copyright (c) 2021, 2022 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+
+using MozJpegFileType.Interop;
+using System;
+
+namespace MozJpegFileType.Tests
+{
+    /// <summary>
+    /// Checks for the maxMemoryToUse and maxScans decode options and the decode statistics.
+    /// </summary>
+    internal static class MemoryLimitTests
+    {
+        private const int ImageWidth = 1024;
+        private const int ImageHeight = 768;
+        // Far too small for the decoder state of any image.
+        private const long TinyMemoryLimit = 16 * 1024;
+
+        public static void Run()
+        {
+            byte[] progressiveJpeg = NativeCodec.Encode(
+                TestImage.CreatePhotoLike(ImageWidth, ImageHeight),
+                new EncodeOptions { quality = 90, chromaSubsampling = ChromaSubsampling.Subsampling420, progressive = true });
+
+            DecodeStatus status = NativeCodec.Decode(
+                progressiveJpeg,
+                new DecodeOptions(),
+                out TestImage expected,
+                out DecodeStatistics statistics,
+                out _);
+
+            if (status != DecodeStatus.Ok)
+            {
+                TestResults.Check("Decode the progressive test image", false);
+                return;
+            }
+
+            PeakMemoryUsageIsReported(statistics);
+            TinyMemoryLimitFailsCleanly(progressiveJpeg);
+            MemoryLimitMovesCoefficientsToTemporaryFile(progressiveJpeg, expected, statistics);
+            MaxScansStopsEarly(progressiveJpeg, expected, 0);
+            MaxScansStopsEarly(progressiveJpeg, expected, GetSpillingMemoryLimit(statistics));
+        }
+
+        private static void PeakMemoryUsageIsReported(DecodeStatistics statistics)
+        {
+            // The coefficient buffers of the whole image are 2 bytes per sample, 1.5 samples per pixel for 4:2:0.
+            ulong coefficientBytes = (ulong)ImageWidth * ImageHeight * 3;
+
+            bool passed = statistics.peakMemoryUsage >= coefficientBytes && statistics.backingStoreBytes == 0;
+
+            TestResults.Check(nameof(PeakMemoryUsageIsReported), passed);
+        }
+
+        private static void TinyMemoryLimitFailsCleanly(byte[] jpeg)
+        {
+            DecodeStatus status = NativeCodec.Decode(
+                jpeg,
+                new DecodeOptions { maxMemoryToUse = TinyMemoryLimit },
+                out _,
+                out DecodeStatistics statistics,
+                out _);
+
+            // The decoder must still work after the failed decode released its memory.
+            DecodeStatus nextStatus = NativeCodec.Decode(jpeg, new DecodeOptions(), out TestImage image);
+
+            bool passed = status == DecodeStatus.OutOfMemory
+                          && statistics.peakMemoryUsage <= TinyMemoryLimit
+                          && nextStatus == DecodeStatus.Ok
+                          && image != null;
+
+            TestResults.Check(nameof(TinyMemoryLimitFailsCleanly), passed);
+        }
+
+        private static void MemoryLimitMovesCoefficientsToTemporaryFile(
+            byte[] jpeg,
+            TestImage expected,
+            DecodeStatistics unlimitedStatistics)
+        {
+            long limit = GetSpillingMemoryLimit(unlimitedStatistics);
+
+            DecodeStatus status = NativeCodec.Decode(
+                jpeg,
+                new DecodeOptions { maxMemoryToUse = limit },
+                out TestImage image,
+                out DecodeStatistics statistics,
+                out _);
+
+            bool passed = status == DecodeStatus.Ok
+                          && statistics.peakMemoryUsage <= (ulong)limit
+                          && statistics.backingStoreBytes > 0
+                          && image.Pixels.AsSpan().SequenceEqual(expected.Pixels);
+
+            TestResults.Check(nameof(MemoryLimitMovesCoefficientsToTemporaryFile), passed);
+        }
+
+        private static void MaxScansStopsEarly(byte[] jpeg, TestImage expected, long memoryLimit)
+        {
+            DecodeStatus status = NativeCodec.Decode(
+                jpeg,
+                new DecodeOptions { maxScans = 1, maxMemoryToUse = memoryLimit },
+                out TestImage image,
+                out _,
+                out int bytesRead);
+
+            // The first scan only has the DC coefficients, so the image is a blurred version of the full decode.
+            bool passed = status == DecodeStatus.Ok
+                          && bytesRead < jpeg.Length
+                          && !image.Pixels.AsSpan().SequenceEqual(expected.Pixels)
+                          && TestImage.ComputePsnr(image, expected) >= 20.0;
+
+            TestResults.Check($"{nameof(MaxScansStopsEarly)}(maxMemoryToUse: {memoryLimit})", passed);
+        }
+
+        private static long GetSpillingMemoryLimit(DecodeStatistics unlimitedStatistics)
+        {
+            // Keep roughly a quarter of the coefficient buffers in memory.
+            ulong coefficientBytes = (ulong)ImageWidth * ImageHeight * 3;
+
+            return (long)(unlimitedStatistics.peakMemoryUsage - (coefficientBytes * 3 / 4));
+        }
+    }
+}
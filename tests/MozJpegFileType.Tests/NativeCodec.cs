@@ -0,0 +1,310 @@
+﻿////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-mozjpeg, a FileType plugin for Paint.NET
+// that saves JPEG images using the mozjpeg encoder.
+//
+// Copyright (c) 2021, 2022 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+using MozJpegFileType.Interop;
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Runtime.InteropServices;
+
+namespace MozJpegFileType.Tests
+{
+    /// <summary>
+    /// Calls the x64 native library through the same bindings that the plugin uses.
+    /// </summary>
+    internal static class NativeCodec
+    {
+        private const string NativeLibraryName = "MozJpegFileTypeIO_x64.dll";
+
+        /// <summary>
+        /// Gets a value indicating whether the native library was copied to the output directory.
+        /// </summary>
+        public static bool IsAvailable()
+        {
+            if (RuntimeInformation.ProcessArchitecture != Architecture.X64)
+            {
+                return false;
+            }
+
+            return NativeLibrary.TryLoad(Path.Combine(AppContext.BaseDirectory, NativeLibraryName), out _);
+        }
+
+        public static byte[] Encode(TestImage image, EncodeOptions options)
+        {
+            // The native encoder requires a metadata structure, even when it is empty.
+            return Encode(image, options, new MetadataParams(null, null, null, new List<byte[]>()));
+        }
+
+        public static unsafe byte[] Encode(TestImage image, EncodeOptions options, MetadataParams metadata)
+        {
+            return Encode(image, options, metadata, null);
+        }
+
+        public static unsafe byte[] Encode(TestImage image, EncodeOptions options, out EncodeStatistics statistics)
+        {
+            EncodeStatistics encodeStatistics = new EncodeStatistics();
+
+            byte[] jpeg = Encode(image, options, new MetadataParams(null, null, null, new List<byte[]>()), &encodeStatistics);
+
+            statistics = encodeStatistics;
+
+            return jpeg;
+        }
+
+        private static unsafe byte[] Encode(TestImage image, EncodeOptions options, MetadataParams metadata, EncodeStatistics* statistics)
+        {
+            using (MemoryStream output = new MemoryStream())
+            {
+                BitmapData bitmapData = CreateBitmapData(image);
+                JpegLibraryErrorInfo errorInfo = new JpegLibraryErrorInfo();
+                WriteCallback writeCallback = (IntPtr data, UIntPtr dataSize) =>
+                {
+                    output.Write(new ReadOnlySpan<byte>(data.ToPointer(), checked((int)dataSize.ToUInt32())));
+                    return true;
+                };
+
+                EncodeStatus status = MozJpeg_X64.WriteImage(ref bitmapData, ref options, metadata, statistics, ref errorInfo, null, writeCallback);
+
+                GC.KeepAlive(writeCallback);
+
+                if (status != EncodeStatus.Ok)
+                {
+                    throw new InvalidOperationException($"WriteImage failed with {status}: {new string(errorInfo.errorMessage)}");
+                }
+
+                return output.ToArray();
+            }
+        }
+
+        public static unsafe byte[] EncodeIncremental(IncrementalEncoderHandle encoder, TestImage image, EncodeOptions options)
+        {
+            using (MemoryStream output = new MemoryStream())
+            {
+                BitmapData bitmapData = CreateBitmapData(image);
+                MetadataParams metadata = new MetadataParams(null, null, null, new List<byte[]>());
+                JpegLibraryErrorInfo errorInfo = new JpegLibraryErrorInfo();
+                WriteCallback writeCallback = (IntPtr data, UIntPtr dataSize) =>
+                {
+                    output.Write(new ReadOnlySpan<byte>(data.ToPointer(), checked((int)dataSize.ToUInt32())));
+                    return true;
+                };
+
+                EncodeStatus status = MozJpeg_X64.WriteImageIncremental(
+                    encoder,
+                    ref bitmapData,
+                    ref options,
+                    metadata,
+                    ref errorInfo,
+                    null,
+                    writeCallback);
+
+                GC.KeepAlive(writeCallback);
+
+                if (status != EncodeStatus.Ok)
+                {
+                    throw new InvalidOperationException($"WriteImageIncremental failed with {status}: {new string(errorInfo.errorMessage)}");
+                }
+
+                return output.ToArray();
+            }
+        }
+
+        public static unsafe byte[] Recompress(byte[] jpeg, RecompressOptions options)
+        {
+            using (MemoryStream output = new MemoryStream())
+            {
+                JpegInput input = new JpegInput(jpeg);
+                ReadCallbacks callbacks = CreateReadCallbacks(input);
+                JpegLibraryErrorInfo errorInfo = new JpegLibraryErrorInfo();
+                WriteCallback writeCallback = (IntPtr data, UIntPtr dataSize) =>
+                {
+                    output.Write(new ReadOnlySpan<byte>(data.ToPointer(), checked((int)dataSize.ToUInt32())));
+                    return true;
+                };
+
+                EncodeStatus status = MozJpeg_X64.RecompressJpeg(callbacks, ref options, ref errorInfo, writeCallback);
+
+                GC.KeepAlive(callbacks);
+                GC.KeepAlive(writeCallback);
+
+                if (status != EncodeStatus.Ok)
+                {
+                    throw new InvalidOperationException($"RecompressJpeg failed with {status}: {new string(errorInfo.errorMessage)}");
+                }
+
+                return output.ToArray();
+            }
+        }
+
+        /// <summary>
+        /// Decodes the image and returns the metadata blocks in the order that the decoder reported them.
+        /// </summary>
+        public static unsafe List<KeyValuePair<MetadataType, byte[]>> ReadMetadata(byte[] jpeg)
+        {
+            List<KeyValuePair<MetadataType, byte[]>> blocks = new List<KeyValuePair<MetadataType, byte[]>>();
+
+            JpegInput input = new JpegInput(jpeg);
+            TestImage decoded = null;
+
+            ReadCallbacks callbacks = CreateReadCallbacks(input);
+            callbacks.allocateSurface = (int width, int height, out int stride) =>
+            {
+                decoded = new TestImage(width, height);
+                stride = decoded.Stride;
+
+                return decoded.Scan0;
+            };
+            callbacks.setIccProfile = (IntPtr data, int size, MetadataType type) =>
+            {
+                byte[] bytes = new byte[size];
+                Marshal.Copy(data, bytes, 0, size);
+                blocks.Add(new KeyValuePair<MetadataType, byte[]>(type, bytes));
+
+                return true;
+            };
+
+            DecodeOptions options = new DecodeOptions();
+            JpegLibraryErrorInfo errorInfo = new JpegLibraryErrorInfo();
+
+            DecodeStatus status = MozJpeg_X64.ReadImage(callbacks, ref options, null, ref errorInfo);
+
+            GC.KeepAlive(callbacks);
+
+            if (status != DecodeStatus.Ok)
+            {
+                throw new InvalidOperationException($"ReadImage failed with {status}.");
+            }
+
+            return blocks;
+        }
+
+        public static DecodeStatus Decode(byte[] jpeg, DecodeOptions options, out TestImage image)
+        {
+            return Decode(jpeg, options, out image, out _, out _);
+        }
+
+        public static unsafe DecodeStatus Decode(
+            byte[] jpeg,
+            DecodeOptions options,
+            out TestImage image,
+            out DecodeStatistics statistics,
+            out int bytesRead)
+        {
+            JpegInput input = new JpegInput(jpeg);
+            TestImage decoded = null;
+
+            ReadCallbacks callbacks = CreateReadCallbacks(input);
+            callbacks.allocateSurface = (int width, int height, out int stride) =>
+            {
+                decoded = new TestImage(width, height);
+                stride = decoded.Stride;
+
+                return decoded.Scan0;
+            };
+
+            JpegLibraryErrorInfo errorInfo = new JpegLibraryErrorInfo();
+            DecodeStatistics decodeStatistics = new DecodeStatistics();
+
+            DecodeStatus status = MozJpeg_X64.ReadImage(callbacks, ref options, &decodeStatistics, ref errorInfo);
+
+            GC.KeepAlive(callbacks);
+
+            image = decoded;
+            statistics = decodeStatistics;
+            bytesRead = input.BytesRead;
+
+            return status;
+        }
+
+        public static unsafe DecodeStatus DecodeRows(
+            byte[] jpeg,
+            DecodeOptions options,
+            int bandHeight,
+            ConsumeRowsCallback consumeRows)
+        {
+            JpegInput input = new JpegInput(jpeg);
+
+            ReadCallbacks callbacks = CreateReadCallbacks(input);
+            RowBandOptions rowBands = new RowBandOptions
+            {
+                bandHeight = bandHeight,
+                consumeRows = consumeRows
+            };
+
+            JpegLibraryErrorInfo errorInfo = new JpegLibraryErrorInfo();
+
+            DecodeStatus status = MozJpeg_X64.ReadImageRows(callbacks, ref options, rowBands, null, ref errorInfo);
+
+            GC.KeepAlive(callbacks);
+            GC.KeepAlive(rowBands);
+
+            return status;
+        }
+
+        private static unsafe BitmapData CreateBitmapData(TestImage image)
+        {
+            return new BitmapData
+            {
+                scan0 = (byte*)image.Scan0,
+                width = (uint)image.Width,
+                height = (uint)image.Height,
+                stride = (uint)image.Stride
+            };
+        }
+
+        private static ReadCallbacks CreateReadCallbacks(JpegInput input)
+        {
+            return new ReadCallbacks
+            {
+                read = input.Read,
+                skipBytes = input.SkipBytes,
+                setIccProfile = (IntPtr data, int size, MetadataType type) => true
+            };
+        }
+
+        private sealed class JpegInput
+        {
+            private readonly byte[] data;
+            private int position;
+
+            public JpegInput(byte[] data)
+            {
+                this.data = data;
+                this.position = 0;
+            }
+
+            public int BytesRead => this.position;
+
+            public int Read(IntPtr buffer, int maxNumberOfBytesToRead)
+            {
+                int count = Math.Min(maxNumberOfBytesToRead, this.data.Length - this.position);
+
+                Marshal.Copy(this.data, this.position, buffer, count);
+                this.position += count;
+
+                return count;
+            }
+
+            public bool SkipBytes(int numberOfBytesToSkip)
+            {
+                if (numberOfBytesToSkip > this.data.Length - this.position)
+                {
+                    return false;
+                }
+
+                this.position += numberOfBytesToSkip;
+
+                return true;
+            }
+        }
+    }
+}
@@ -0,0 +1,57 @@
+﻿////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-mozjpeg, a FileType plugin for Paint.NET
+// that saves JPEG images using the mozjpeg encoder.
+//
+// Copyright (c) 2021, 2022 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+using System;
+
+namespace MozJpegFileType.Tests
+{
+    internal static class Program
+    {
+        private static int Main(string[] args)
+        {
+            if (args.Length > 0 && args[0] == "--benchmark")
+            {
+                if (!NativeCodec.IsAvailable())
+                {
+                    Console.WriteLine("The benchmark requires MozJpegFileTypeIO_x64.dll in the output directory.");
+                    return 1;
+                }
+
+                DecodeBenchmark.Run();
+                return 0;
+            }
+
+            EncodeCacheTests.Run();
+
+            if (NativeCodec.IsAvailable())
+            {
+                RowBandTests.Run();
+                DecodeQualityTests.Run();
+                MemoryLimitTests.Run();
+                RecompressTests.Run();
+                IncrementalTests.Run();
+                SinglePassTests.Run();
+                AutoSelectTests.Run();
+            }
+            else
+            {
+                TestResults.Skip("native library tests", "MozJpegFileTypeIO_x64.dll was not found in the output directory");
+            }
+
+            int failureCount = TestResults.FailureCount;
+
+            Console.WriteLine(failureCount == 0 ? "All tests passed." : $"{failureCount} test(s) failed.");
+
+            return failureCount == 0 ? 0 : 1;
+        }
+    }
+}
@@ -0,0 +1,175 @@
+﻿////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-mozjpeg, a FileType plugin for Paint.NET
+// that saves JPEG images using the mozjpeg encoder.
+//
+// Copyright (c) 2021, 2022 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+
+using MozJpegFileType.Interop;
+using System;
+using System.Collections.Generic;
+using System.Text;
+
+namespace MozJpegFileType.Tests
+{
+    /// <summary>
+    /// Checks for the RecompressJpeg export.
+    /// </summary>
+    internal static class RecompressTests
+    {
+        private const int SourceQuality = 95;
+        private const int TargetQuality = 70;
+        // The PSNR of the recompressed image against the decoded source image.
+        private const double MinimumRecompressedPsnr = 30.0;
+
+        public static void Run()
+        {
+            MetadataParams metadata = CreateTestMetadata();
+            byte[] source = NativeCodec.Encode(
+                TestImage.CreatePhotoLike(256, 192),
+                new EncodeOptions { quality = SourceQuality, chromaSubsampling = ChromaSubsampling.Subsampling420 },
+                metadata);
+
+            RecompressToLowerQuality(source, progressive: false);
+            RecompressToLowerQuality(source, progressive: true);
+            RecompressKeepsMetadata(source);
+        }
+
+        private static void RecompressToLowerQuality(byte[] source, bool progressive)
+        {
+            byte[] recompressed = NativeCodec.Recompress(
+                source,
+                new RecompressOptions { quality = TargetQuality, progressive = progressive });
+
+            NativeCodec.Decode(source, new DecodeOptions(), out TestImage sourceImage);
+            DecodeStatus status = NativeCodec.Decode(recompressed, new DecodeOptions(), out TestImage recompressedImage);
+
+            bool passed = recompressed.Length < source.Length
+                          && QuantizationTablesAreNotFiner(ReadQuantizationTables(source), ReadQuantizationTables(recompressed))
+                          && status == DecodeStatus.Ok
+                          && TestImage.ComputePsnr(sourceImage, recompressedImage) >= MinimumRecompressedPsnr;
+
+            TestResults.Check($"{nameof(RecompressToLowerQuality)}(progressive: {progressive})", passed);
+        }
+
+        private static void RecompressKeepsMetadata(byte[] source)
+        {
+            byte[] recompressed = NativeCodec.Recompress(source, new RecompressOptions { quality = TargetQuality });
+
+            List<KeyValuePair<MetadataType, byte[]>> expected = NativeCodec.ReadMetadata(source);
+            List<KeyValuePair<MetadataType, byte[]>> actual = NativeCodec.ReadMetadata(recompressed);
+
+            bool passed = expected.Count == 3 && actual.Count == expected.Count;
+
+            for (int i = 0; passed && i < expected.Count; i++)
+            {
+                passed = actual[i].Key == expected[i].Key && actual[i].Value.AsSpan().SequenceEqual(expected[i].Value);
+            }
+
+            TestResults.Check(nameof(RecompressKeepsMetadata), passed);
+        }
+
+        private static MetadataParams CreateTestMetadata()
+        {
+            // The encoder writes the blocks as they are, so the EXIF and XMP blocks include their APP1 signatures.
+            byte[] exif = Encoding.ASCII.GetBytes("Exif\0\0MM\0*\0\0\0\u0008\0\0");
+            byte[] standardXmp = Encoding.ASCII.GetBytes("http://ns.adobe.com/xap/1.0/\0<x:xmpmeta xmlns:x=\"adobe:ns:meta/\"/>");
+            byte[] iccProfile = new byte[500];
+            new Random(1234).NextBytes(iccProfile);
+
+            return new MetadataParams(exif, iccProfile, standardXmp, new List<byte[]>());
+        }
+
+        private static bool QuantizationTablesAreNotFiner(Dictionary<int, ushort[]> source, Dictionary<int, ushort[]> recompressed)
+        {
+            if (source.Count == 0 || recompressed.Count != source.Count)
+            {
+                return false;
+            }
+
+            foreach (KeyValuePair<int, ushort[]> table in source)
+            {
+                if (!recompressed.TryGetValue(table.Key, out ushort[] recompressedTable))
+                {
+                    return false;
+                }
+
+                for (int i = 0; i < table.Value.Length; i++)
+                {
+                    if (recompressedTable[i] < table.Value[i])
+                    {
+                        return false;
+                    }
+                }
+            }
+
+            return true;
+        }
+
+        /// <summary>
+        /// Reads the DQT segments that come before the first scan, keyed by the table index.
+        /// </summary>
+        private static Dictionary<int, ushort[]> ReadQuantizationTables(byte[] jpeg)
+        {
+            const byte DefineQuantizationTables = 0xDB;
+            const byte StartOfScan = 0xDA;
+
+            Dictionary<int, ushort[]> tables = new Dictionary<int, ushort[]>();
+
+            // Skip the SOI marker.
+            int offset = 2;
+
+            while (offset + 4 <= jpeg.Length && jpeg[offset] == 0xFF)
+            {
+                byte marker = jpeg[offset + 1];
+                int segmentLength = (jpeg[offset + 2] << 8) | jpeg[offset + 3];
+
+                if (marker == StartOfScan)
+                {
+                    break;
+                }
+
+                if (marker == DefineQuantizationTables)
+                {
+                    int position = offset + 4;
+                    int segmentEnd = offset + 2 + segmentLength;
+
+                    while (position < segmentEnd)
+                    {
+                        int precision = jpeg[position] >> 4;
+                        int tableIndex = jpeg[position] & 0x0F;
+                        position++;
+
+                        ushort[] values = new ushort[64];
+
+                        for (int i = 0; i < values.Length; i++)
+                        {
+                            if (precision == 0)
+                            {
+                                values[i] = jpeg[position];
+                                position++;
+                            }
+                            else
+                            {
+                                values[i] = (ushort)((jpeg[position] << 8) | jpeg[position + 1]);
+                                position += 2;
+                            }
+                        }
+
+                        tables[tableIndex] = values;
+                    }
+                }
+
+                offset += 2 + segmentLength;
+            }
+
+            return tables;
+        }
+    }
+}
@@ -0,0 +1,82 @@
+﻿////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-mozjpeg, a FileType plugin for Paint.NET
+// that saves JPEG images using the mozjpeg encoder.
+//
+// Copyright (c) 2021, 2022 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+using MozJpegFileType.Interop;
+using System;
+using System.Collections.Generic;
+using System.Runtime.InteropServices;
+
+namespace MozJpegFileType.Tests
+{
+    /// <summary>
+    /// Checks for the ReadImageRows export.
+    /// </summary>
+    internal static class RowBandTests
+    {
+        private const int ImageWidth = 50;
+        private const int ImageHeight = 37;
+
+        public static void Run()
+        {
+            byte[] jpeg = NativeCodec.Encode(
+                TestImage.CreatePhotoLike(ImageWidth, ImageHeight),
+                new EncodeOptions { quality = 90, chromaSubsampling = ChromaSubsampling.Subsampling420 });
+
+            NativeCodec.Decode(jpeg, new DecodeOptions(), out TestImage expected);
+
+            BandsCoverTheImage(jpeg, expected, 8, new int[] { 8, 8, 8, 8, 5 });
+            BandsCoverTheImage(jpeg, expected, 1000, new int[] { ImageHeight });
+            // A band height of 0 uses the height of one MCU row, 16 pixels for 4:2:0 chroma subsampling.
+            BandsCoverTheImage(jpeg, expected, 0, new int[] { 16, 16, 5 });
+        }
+
+        private static void BandsCoverTheImage(byte[] jpeg, TestImage expected, int bandHeight, int[] expectedRowCounts)
+        {
+            const int BytesPerPixel = 4;
+
+            List<int> rowCounts = new List<int>();
+            byte[] packedImage = new byte[ImageWidth * ImageHeight * BytesPerPixel];
+            uint nextRow = 0;
+            bool bandsValid = true;
+
+            ConsumeRowsCallback consumeRows = (IntPtr rows, uint firstRow, int rowCount, UIntPtr stride, ulong firstRowOffset) =>
+            {
+                ulong rowBytes = (ulong)ImageWidth * BytesPerPixel;
+
+                bandsValid &= firstRow == nextRow
+                              && stride.ToUInt64() == rowBytes
+                              && firstRowOffset == firstRow * rowBytes;
+
+                if (bandsValid)
+                {
+                    Marshal.Copy(rows, packedImage, (int)firstRowOffset, checked((int)rowBytes * rowCount));
+                }
+
+                rowCounts.Add(rowCount);
+                nextRow = firstRow + (uint)rowCount;
+
+                return true;
+            };
+
+            DecodeStatus status = NativeCodec.DecodeRows(jpeg, new DecodeOptions(), bandHeight, consumeRows);
+
+            GC.KeepAlive(consumeRows);
+
+            bool passed = status == DecodeStatus.Ok
+                          && bandsValid
+                          && rowCounts.ToArray().AsSpan().SequenceEqual(expectedRowCounts)
+                          && packedImage.AsSpan().SequenceEqual(expected.Pixels);
+
+            TestResults.Check($"{nameof(BandsCoverTheImage)}(bandHeight: {bandHeight})", passed);
+        }
+    }
+}
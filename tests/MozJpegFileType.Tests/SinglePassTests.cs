@@ -0,0 +1,63 @@
+﻿////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-mozjpeg, a FileType plugin for Paint.NET
+// that saves JPEG images using the mozjpeg encoder.
+//
+// Copyright (c) 2021, 2022 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+
+using MozJpegFileType.Interop;
+using System;
+
+namespace MozJpegFileType.Tests
+{
+    /// <summary>
+    /// Checks the size penalty that the single pass mode reports against an optimized encode.
+    /// </summary>
+    internal static class SinglePassTests
+    {
+        public static void Run()
+        {
+            TestImage source = TestImage.CreatePhotoLike(512, 384);
+
+            ReportsSizePenalty(source, ChromaSubsampling.Subsampling420);
+            ReportsSizePenalty(source, ChromaSubsampling.Subsampling444);
+            OptimizedSizeIsOnlyMeasuredForSinglePass(source);
+        }
+
+        private static void ReportsSizePenalty(TestImage source, ChromaSubsampling chromaSubsampling)
+        {
+            byte[] jpeg = NativeCodec.Encode(
+                source,
+                new EncodeOptions { quality = 85, chromaSubsampling = chromaSubsampling, singlePass = true },
+                out EncodeStatistics statistics);
+
+            double penalty = ((double)statistics.outputSize / statistics.optimizedSize) - 1.0;
+
+            Console.WriteLine($"{chromaSubsampling}: single pass {statistics.outputSize} bytes, optimized {statistics.optimizedSize} bytes, penalty {penalty:P1}");
+
+            bool passed = statistics.outputSize == (ulong)jpeg.Length
+                          && statistics.optimizedSize > 0
+                          && statistics.optimizedSize < statistics.outputSize;
+
+            TestResults.Check($"{nameof(ReportsSizePenalty)}({chromaSubsampling})", passed);
+        }
+
+        private static void OptimizedSizeIsOnlyMeasuredForSinglePass(TestImage source)
+        {
+            byte[] jpeg = NativeCodec.Encode(
+                source,
+                new EncodeOptions { quality = 85, chromaSubsampling = ChromaSubsampling.Subsampling420 },
+                out EncodeStatistics statistics);
+
+            bool passed = statistics.outputSize == (ulong)jpeg.Length && statistics.optimizedSize == 0;
+
+            TestResults.Check(nameof(OptimizedSizeIsOnlyMeasuredForSinglePass), passed);
+        }
+    }
+}
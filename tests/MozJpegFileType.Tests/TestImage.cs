@@ -0,0 +1,123 @@
+﻿////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-mozjpeg, a FileType plugin for Paint.NET
+// that saves JPEG images using the mozjpeg encoder.
+//
+// Copyright (c) 2021, 2022 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+using System;
+using System.Runtime.InteropServices;
+
+namespace MozJpegFileType.Tests
+{
+    /// <summary>
+    /// A pinned BGRA image that the native library can read and write.
+    /// </summary>
+    internal sealed class TestImage
+    {
+        private const int BytesPerPixel = 4;
+
+        public TestImage(int width, int height)
+        {
+            this.Width = width;
+            this.Height = height;
+            this.Stride = width * BytesPerPixel;
+            this.Pixels = GC.AllocateArray<byte>(this.Stride * height, pinned: true);
+        }
+
+        public int Width { get; }
+
+        public int Height { get; }
+
+        public int Stride { get; }
+
+        public byte[] Pixels { get; }
+
+        public IntPtr Scan0 => Marshal.UnsafeAddrOfPinnedArrayElement(this.Pixels, 0);
+
+        /// <summary>
+        /// Creates an image with smooth gradients, edges and fine texture, so that the
+        /// encoder and decoder settings have a measurable effect on the output.
+        /// </summary>
+        public static TestImage CreatePhotoLike(int width, int height)
+        {
+            TestImage image = new TestImage(width, height);
+            Random random = new Random(1234);
+
+            for (int y = 0; y < height; y++)
+            {
+                for (int x = 0; x < width; x++)
+                {
+                    double gradient = (x + y) * 255.0 / (width + height);
+                    double wave = 40.0 * Math.Sin(x * 0.15) * Math.Cos(y * 0.11);
+                    double edge = ((x / 24) + (y / 24)) % 2 == 0 ? 30.0 : -30.0;
+                    double noise = random.Next(-12, 13);
+
+                    int offset = (y * image.Stride) + (x * BytesPerPixel);
+
+                    image.Pixels[offset] = ClampToByte(gradient + wave + noise);
+                    image.Pixels[offset + 1] = ClampToByte(128.0 + edge + (wave * 0.5) + noise);
+                    image.Pixels[offset + 2] = ClampToByte(255.0 - gradient + edge + noise);
+                    image.Pixels[offset + 3] = 255;
+                }
+            }
+
+            return image;
+        }
+
+        /// <summary>
+        /// Computes the peak signal-to-noise ratio of the blue, green and red channels.
+        /// </summary>
+        public static double ComputePsnr(TestImage first, TestImage second)
+        {
+            if (first.Width != second.Width || first.Height != second.Height)
+            {
+                throw new ArgumentException("The images must have the same size.");
+            }
+
+            double sumOfSquares = 0;
+
+            for (int y = 0; y < first.Height; y++)
+            {
+                for (int x = 0; x < first.Width; x++)
+                {
+                    int firstOffset = (y * first.Stride) + (x * BytesPerPixel);
+                    int secondOffset = (y * second.Stride) + (x * BytesPerPixel);
+
+                    for (int i = 0; i < 3; i++)
+                    {
+                        double difference = first.Pixels[firstOffset + i] - second.Pixels[secondOffset + i];
+                        sumOfSquares += difference * difference;
+                    }
+                }
+            }
+
+            if (sumOfSquares == 0)
+            {
+                return double.PositiveInfinity;
+            }
+
+            double meanSquaredError = sumOfSquares / (first.Width * (double)first.Height * 3);
+
+            return 10.0 * Math.Log10(255.0 * 255.0 / meanSquaredError);
+        }
+
+        public TestImage Clone()
+        {
+            TestImage clone = new TestImage(this.Width, this.Height);
+            this.Pixels.AsSpan().CopyTo(clone.Pixels);
+
+            return clone;
+        }
+
+        private static byte ClampToByte(double value)
+        {
+            return (byte)Math.Clamp((int)Math.Round(value), 0, 255);
+        }
+    }
+}
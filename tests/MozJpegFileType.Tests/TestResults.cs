@@ -0,0 +1,36 @@
+﻿////////////////////////////////////////////////////////////////////////
+//
+// This file is part of pdn-mozjpeg, a FileType plugin for Paint.NET
+// that saves JPEG images using the mozjpeg encoder.
+//
+// Copyright (c) 2021, 2022 Nicholas Hayes
+//
+// This file is licensed under the MIT License.
+// See LICENSE.txt for complete licensing and attribution information.
+//
+////////////////////////////////////////////////////////////////////////
+
+using System;
+
+namespace MozJpegFileType.Tests
+{
+    internal static class TestResults
+    {
+        public static int FailureCount { get; private set; }
+
+        public static void Check(string name, bool passed)
+        {
+            Console.WriteLine($"{(passed ? "PASS" : "FAIL")}: {name}");
+
+            if (!passed)
+            {
+                FailureCount++;
+            }
+        }
+
+        public static void Skip(string name, string reason)
+        {
+            Console.WriteLine($"SKIP: {name} ({reason})");
+        }
+    }
+}